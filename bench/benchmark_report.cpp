@@ -0,0 +1,27 @@
+// Benchmark::run(): the psychropy and DensityModel accuracy and throughput report, printed as
+// one JSON document and written with Benchmark::dump() when a path is given
+//
+//   gcc -std=c99 -O2 -pthread -I.. -c ../psychropy.c -o psychropy.o
+//   g++ -std=c++14 -O2 -fPIC -I.. benchmark_report.cpp psychropy.o -o benchmark_report
+//       -lpthread $(pkg-config --cflags --libs Qt5Core)
+//   ./benchmark_report [rounds] [report.json]
+
+#include <QJsonDocument>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include "benchmark.hpp"
+
+int main(int argc, char* argv[]) {
+    const int rounds = argc > 1 ? std::max(1, std::atoi(argv[1])) : 3;
+    if (argc > 2) {
+        if (!Benchmark::dump(argv[2], rounds)) {
+            std::fprintf(stderr, "cannot write %s\n", argv[2]);
+            return 1;
+        }
+        return 0;
+    }
+    std::fputs(QJsonDocument(Benchmark::run(rounds)).toJson().constData(), stdout);
+    return 0;
+}
@@ -0,0 +1,158 @@
+/* Scalar psychropy functions against their batched *_n forms: ns per element, speedup and
+    the largest difference over the same inputs, in ulp and absolute, one line per function.
+    Then Wet_bulb_solve over -100..200 C in 25 C bands: mean and worst iterations and ns per
+    solve, cold and warm-started from the previous sample.
+
+        gcc -std=c99 -O2 -march=native -pthread -I.. psychropy_bench.c ../psychropy.c -lm \
+            -o psychropy_bench
+        ./psychropy_bench [elements] [repeats]
+
+    Build with the target's vector width: with plain SSE2 (two lanes) the batched
+    exp/log kernels run slower than libm.
+*/
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "psychropy.h"
+
+static volatile double sink;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// distance of x from ref in units of the last place of ref, NAN only matches NAN
+static double ulps(double ref, double x) {
+    double a = fabs(ref);
+    if (ref == x) return 0;
+    if (isnan(ref) || isnan(x)) return INFINITY;
+    return fabs(ref - x) / (nextafter(a, INFINITY) - a);
+}
+
+static void report(const char* name, double scalar, double batched, size_t n,
+                   const double* ref, const double* out) {
+    double worst = 0, diff = 0;
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        double u = ulps(ref[i], out[i]);
+        if (u > worst) worst = u;
+        if (fabs(ref[i] - out[i]) > diff) diff = fabs(ref[i] - out[i]);
+    }
+    printf("%-18s %10.2f %10.2f %8.2fx %10.0f %10.2g\n", name, scalar / n, batched / n,
+           scalar / batched, worst, diff);
+}
+
+// best of repeats for the scalar loop and for one batched call
+#define BENCH(name, scalarCall, batchedCall)                  \
+    do {                                                      \
+        double scalar = INFINITY, batched = INFINITY, t;      \
+        size_t i;                                             \
+        int r;                                                \
+        r = 0;                                                \
+        do {                                                  \
+            t = now();                                        \
+            for (i = 0; i < n; ++i) ref[i] = scalarCall;      \
+            t = now() - t;                                    \
+            if (t < scalar) scalar = t;                       \
+            t = now();                                        \
+            batchedCall;                                      \
+            t = now() - t;                                    \
+            if (t < batched) batched = t;                     \
+        } while (++r < repeats);                              \
+        sink = ref[n / 2] + out[n / 2];                       \
+        report(name, scalar, batched, n, ref, out);           \
+    } while (0)
+
+// RH sweeps 0..1 for every Tdb step of the band, the pressure is raised above saturation
+static void wet_bulb_sweep(void) {
+    double band;
+    printf("\n%-12s %8s %6s %8s %8s %6s %8s\n", "Tdb band", "cold it", "worst", "cold ns",
+           "warm it", "worst", "warm ns");
+    for (band = -100; band < 200; band += 25) {
+        long coldIterations = 0, warmIterations = 0, samples = 0;
+        int coldWorst = 0, warmWorst = 0;
+        double cold = 0, warm = 0, t, Tdb, RH, guess = NAN, Twb;
+        for (Tdb = band; Tdb < band + 25; Tdb += 0.05) {
+            double Pws = Sat_press(Tdb), P = Pws < 50 ? 101.325 : 2 * Pws + 10;
+            for (RH = 0.02; RH < 1; RH += 0.04) {
+                int iterations = 0;
+                t = now();
+                Wet_bulb_solve(Tdb, RH, P, NAN, &Twb, &iterations);
+                cold += now() - t;
+                coldIterations += iterations;
+                if (iterations > coldWorst) coldWorst = iterations;
+                t = now();
+                Wet_bulb_solve(Tdb, RH, P, guess, &Twb, &iterations);
+                warm += now() - t;
+                warmIterations += iterations;
+                if (iterations > warmWorst) warmWorst = iterations;
+                if (!isnan(Twb)) guess = Twb;
+                sink = Twb;
+                ++samples;
+            }
+            guess = NAN;  // RH wraps around, a new series starts
+        }
+        printf("%5.0f..%-5.0f %8.2f %6d %8.1f %8.2f %6d %8.1f\n", band, band + 25,
+               (double)coldIterations / samples, coldWorst, cold / samples,
+               (double)warmIterations / samples, warmWorst, warm / samples);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? (size_t)atol(argv[1]) : 65536;
+    int repeats = argc > 2 && atoi(argv[2]) > 0 ? atoi(argv[2]) : 20;
+    double* Tdb = malloc(n * sizeof(double));
+    double* RH = malloc(n * sizeof(double));
+    double* P = malloc(n * sizeof(double));
+    double* W = malloc(n * sizeof(double));
+    double* Twb = malloc(n * sizeof(double));
+    double* h = malloc(n * sizeof(double));
+    double* ref = malloc(n * sizeof(double));
+    double* out = malloc(n * sizeof(double));
+    size_t i;
+    if (!Tdb || !RH || !P || !W || !Twb || !h || !ref || !out || n == 0) return 1;
+
+    // a slowly drifting sensor series over the cell's operating range
+    srand(1);
+    for (i = 0; i < n; ++i) {
+        Tdb[i] = -20 + 80.0 * i / n + rand() / (double)RAND_MAX;
+        RH[i] = 0.05 + 0.9 * rand() / (double)RAND_MAX;
+        P[i] = 101.325 + 2.0 * rand() / (double)RAND_MAX - 1.0;
+        W[i] = Hum_rat2(Tdb[i], RH[i], P[i]);
+        Twb[i] = Wet_bulb(Tdb[i], RH[i], P[i]);
+        h[i] = Enthalpy_Air_H2O(Tdb[i], W[i]);
+    }
+
+    printf("%zu elements, best of %d\n", n, repeats);
+    printf("%-18s %10s %10s %9s %10s %10s\n", "function", "scalar ns", "batch ns", "speedup",
+           "max ulp", "max abs");
+    BENCH("Part_press", Part_press(P[i], W[i]), Part_press_n(P, W, out, n));
+    BENCH("Sat_press", Sat_press(Tdb[i]), Sat_press_n(Tdb, out, n));
+    BENCH("Hum_rat", Hum_rat(Tdb[i], Twb[i], P[i]), Hum_rat_n(Tdb, Twb, P, out, n));
+    BENCH("Hum_rat2", Hum_rat2(Tdb[i], RH[i], P[i]), Hum_rat2_n(Tdb, RH, P, out, n));
+    BENCH("Rel_hum", Rel_hum(Tdb[i], Twb[i], P[i]), Rel_hum_n(Tdb, Twb, P, out, n));
+    BENCH("Rel_hum2", Rel_hum2(Tdb[i], W[i], P[i]), Rel_hum2_n(Tdb, W, P, out, n));
+    BENCH("Wet_bulb", Wet_bulb(Tdb[i], RH[i], P[i]), Wet_bulb_n(Tdb, RH, P, out, n));
+    BENCH("Enthalpy_Air_H2O", Enthalpy_Air_H2O(Tdb[i], W[i]),
+          Enthalpy_Air_H2O_n(Tdb, W, out, n));
+    BENCH("T_drybulb_calc", T_drybulb_calc(h[i], W[i]), T_drybulb_calc_n(h, W, out, n));
+    BENCH("Dew_point", Dew_point(P[i], W[i]), Dew_point_n(P, W, out, n));
+    BENCH("Dry_Air_Density", Dry_Air_Density(P[i], Tdb[i], W[i]),
+          Dry_Air_Density_n(P, Tdb, W, out, n));
+    printf("documented bound PSYCHROPY_N_ULP = %d\n", PSYCHROPY_N_ULP);
+    wet_bulb_sweep();
+
+    free(Tdb);
+    free(RH);
+    free(P);
+    free(W);
+    free(Twb);
+    free(h);
+    free(ref);
+    free(out);
+    return 0;
+}
@@ -0,0 +1,243 @@
+// WORM workloads against QSQLITE, no MySQL server needed; prints one JSON document with
+// ops/s of the successful ops, failed ops, p50/p99 latency (us) and heap allocations per op
+// for every workload, followed by the StatisticsHelper snapshot of the run
+//
+//   g++ -std=c++14 -O2 -fPIC -I.. worm_bench.cpp -o worm_bench -lpthread
+//       $(pkg-config --cflags --libs Qt5Core Qt5Sql)
+//   ./worm_bench [wal|file|memory] [pool size] [rows] [threads]
+//
+// wal (the default) opens a file through ConnectionHelper::sqlite() with pool size readers,
+// file and memory open pool size connections through connect(). Shared-cache memory
+// connections fail with "database table is locked" instead of waiting for each other, so
+// the threaded workload reports failures there.
+
+#include <QCoreApplication>
+#include <QFile>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "worm.hpp"
+
+static std::atomic<quint64> allocations{0};
+// statements and acquires that failed, counted through StatisticsHelper::errorHandler
+static std::atomic<quint64> failures{0};
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+class BenchRow {
+public:
+    int id{0};
+    double value{0};
+    QString name;
+    ORMAP("bench", id, value, name)
+};
+
+using namespace WORM;
+
+struct Result {
+    QString name;
+    std::vector<qint64> latency;  // ns per op
+    qint64 elapsed{0};            // ns for the whole workload
+    quint64 allocations{0};
+    quint64 failures{0};
+    int rowsPerOp{1};
+
+    QJsonObject toJson() {
+        std::sort(latency.begin(), latency.end());
+        auto percentile = [this](double p) {
+            if (latency.empty()) return 0.0;
+            return latency[std::min(latency.size() - 1, size_t(p * latency.size()))] / 1000.0;
+        };
+        const double ops = latency.size();
+        // an op with several failed statements still counts once
+        const double succeeded = std::max(0.0, ops - failures);
+        QJsonObject ret;
+        ret["name"] = name;
+        ret["ops"] = ops;
+        ret["failures"] = double(failures);
+        ret["rowsPerOp"] = rowsPerOp;
+        ret["opsPerSec"] = elapsed > 0 ? succeeded * 1e9 / elapsed : 0.0;
+        ret["rowsPerSec"] = elapsed > 0 ? succeeded * rowsPerOp * 1e9 / elapsed : 0.0;
+        ret["p50Us"] = percentile(0.50);
+        ret["p99Us"] = percentile(0.99);
+        ret["allocationsPerOp"] = ops > 0 ? allocations / ops : 0.0;
+        return ret;
+    }
+};
+
+// runs op(i) for i in [0, count) on the calling thread and times each call
+template <typename Fn> static Result measure(const QString& name, int count, Fn op) {
+    Result ret;
+    ret.name = name;
+    ret.latency.reserve(count);
+    const quint64 before = allocations.load(), failed = failures.load();
+    QElapsedTimer total;
+    total.start();
+    for (int i = 0; i < count; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        op(i);
+        ret.latency.push_back(timer.nsecsElapsed());
+    }
+    ret.elapsed = total.nsecsElapsed();
+    ret.allocations = allocations.load() - before;
+    ret.failures = failures.load() - failed;
+    return ret;
+}
+
+static QVector<BenchRow> rows(int first, int count) {
+    QVector<BenchRow> ret(count);
+    for (int i = 0; i < count; ++i) {
+        ret[i].id = first + i;
+        ret[i].value = (first + i) * 0.5;
+        ret[i].name = QString("sample %1").arg(first + i);
+    }
+    return ret;
+}
+
+static void reset() {
+    QueryHelper::remove<BenchRow>();
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    const QString database = argc > 1 ? QString(argv[1]) : QString("wal");
+    const int pool = argc > 2 ? std::max(1, std::atoi(argv[2])) : 4;
+    const int count = argc > 3 ? std::max(100, std::atoi(argv[3])) : 10000;
+    const int threads = argc > 4 ? std::max(1, std::atoi(argv[4])) : 4;
+    if (database != "wal" && database != "file" && database != "memory") {
+        std::fprintf(stderr, "unknown database %s\n", qPrintable(database));
+        return 1;
+    }
+
+    const bool file = database != "memory";
+    const QString path = file ? QString("worm_bench.db") : QString(":memory:");
+    if (file) {
+        QFile::remove(path);
+        QFile::remove(path + "-wal");
+        QFile::remove(path + "-shm");
+    }
+    SqliteOptions options;
+    options.readers = options.maxReaders = pool;
+    const bool opened =
+            database == "wal"
+                    ? ConnectionHelper::sqlite(path, options)
+                    : ConnectionHelper::connect(path, "QSQLITE", QString(), QString(), QString(),
+                                                0, pool);
+    if (!opened) {
+        std::fprintf(stderr, "cannot open %s\n", qPrintable(path));
+        return 1;
+    }
+    QueryHelper::execute("drop table if exists bench;");
+    if (!QueryHelper::execute("create table bench (id integer primary key, value double, "
+                              "name text);")) {
+        std::fprintf(stderr, "cannot create the bench table\n");
+        return 1;
+    }
+    StatisticsHelper::slowQueryThreshold = -1;
+    StatisticsHelper::errorHandler = [](const QString&, const QSqlError&) { ++failures; };
+    StatisticsHelper::reset();
+
+    QJsonArray results;
+
+    reset();
+    results.append(measure("insert", count, [](int i) {
+                       QueryHelper::insert(rows(i, 1));
+                   }).toJson());
+
+    for (int batch : {10, 100, 1000}) {
+        reset();
+        Result result = measure(QString("bulk%1").arg(batch), count / batch, [batch](int i) {
+            QueryHelper::insert(rows(i * batch, batch));
+        });
+        result.rowsPerOp = batch;
+        results.append(result.toJson());
+    }
+
+    // reloaded with ids 0 to count - 1 for the reads and updates below, which change values
+    // only, so every later workload sees the same rows
+    reset();
+    for (int i = 0; i < count; i += 1000) QueryHelper::insert(rows(i, std::min(1000, count - i)));
+
+    const int scans = std::max(10, 1000000 / count);
+    results.append(measure("selectAll", scans, [](int) {
+                       QVector<BenchRow> vec;
+                       QueryHelper::select(vec);
+                   }).toJson());
+
+    results.append(measure("selectWhere", count, [count](int i) {
+                       QVector<BenchRow> vec;
+                       const int first = i * 7919 % count;
+                       QueryHelper::select(vec, "id >= ? and id < ?", {first, first + 10});
+                   }).toJson());
+
+    results.append(measure("update", count, [count](int i) {
+                       BenchRow row = rows(i * 7919 % count, 1).first();
+                       row.value = -i;
+                       QueryHelper::update(row, "id = ?", {row.id});
+                   }).toJson());
+
+    // every thread reads four rows for each one it updates, all on the shared pool
+    {
+        std::vector<Result> parts(threads);
+        std::vector<std::thread> workers;
+        const int perThread = count / threads;
+        const quint64 before = allocations.load(), failed = failures.load();
+        QElapsedTimer total;
+        total.start();
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([t, perThread, count, &parts]() {
+                parts[t] = measure("", perThread, [t, count](int i) {
+                    const int id = (t * 104729 + i * 7919) % count;
+                    if (i % 5 == 4) {
+                        BenchRow row = rows(id, 1).first();
+                        row.value = t;
+                        QueryHelper::update(row, "id = ?", {id});
+                    } else {
+                        QVector<BenchRow> vec;
+                        QueryHelper::select(vec, "id = ?", {id});
+                    }
+                });
+            });
+        }
+        for (auto& it : workers) it.join();
+        Result mixed;
+        mixed.name = QString("mixed%1").arg(threads);
+        mixed.elapsed = total.nsecsElapsed();
+        mixed.allocations = allocations.load() - before;
+        mixed.failures = failures.load() - failed;
+        for (auto& it : parts)
+            mixed.latency.insert(mixed.latency.end(), it.latency.begin(), it.latency.end());
+        results.append(mixed.toJson());
+    }
+
+    QJsonObject config;
+    config["database"] = database;
+    config["pool"] = pool;
+    config["rows"] = count;
+    config["threads"] = threads;
+    QJsonObject out;
+    out["config"] = config;
+    out["results"] = results;
+    out["statistics"] = StatisticsHelper::snapshot();
+    std::fputs(QJsonDocument(out).toJson().constData(), stdout);
+
+    if (file) {
+        QFile::remove(path);
+        QFile::remove(path + "-wal");
+        QFile::remove(path + "-shm");
+    }
+    return 0;
+}
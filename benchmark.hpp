@@ -0,0 +1,732 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QVector>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+
+#include "densitymodel.hpp"
+#include "psychropy.h"
+
+// accuracy and throughput of psychropy.c and DensityModel as one JSON report, so releases can
+// be compared: every exported function and every query plan combination is swept over its
+// domain and checked against the same correlations evaluated in long double
+class Benchmark {
+public:
+    // each timing is the fastest of rounds passes; runs every psych_accuracy mode in turn and
+    // restores the current one, so nothing else may use psychropy meanwhile
+    static QJsonObject run(int rounds = 3) {
+        static const struct {
+            psych_accuracy mode;
+            const char* name;
+        } modes[] = {{PSYCH_ACCURACY_REFERENCE, "reference"},
+                     {PSYCH_ACCURACY_HIGH, "high"},
+                     {PSYCH_ACCURACY_FAST, "fast"}};
+        rounds = std::max(rounds, 1);
+        const psych_accuracy saved = psych_get_accuracy();
+        QJsonObject byMode;
+        for (const auto& m : modes) {
+            QJsonObject report;
+            if (m.mode != PSYCH_ACCURACY_REFERENCE) {  // the documented table bounds
+                double satPress = 0, dewPoint = 0;
+                psych_accuracy_error(m.mode, &satPress, &dewPoint);
+                QJsonObject bound;
+                bound["satPressRel"] = satPress;
+                bound["dewPointAbs"] = dewPoint;
+                report["tables"] = bound;
+            }
+            psych_set_accuracy(m.mode);
+            report["functions"] = functions(rounds);
+            report["psych"] = combinations(rounds);
+            byMode[m.name] = report;
+        }
+        psych_set_accuracy(saved);
+
+        QJsonObject ret;
+        ret["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+#ifdef __VERSION__
+        ret["compiler"] = QString(__VERSION__);
+#endif
+        ret["longDoubleDigits"] = LDBL_MANT_DIG;
+        ret["rounds"] = rounds;
+        ret["modes"] = byMode;
+        ret["densityModel"] = densityModel(rounds);
+        return ret;
+    }
+
+    static bool dump(const QString& path, int rounds = 3) {
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+        return file.write(QJsonDocument(run(rounds)).toJson()) >= 0;
+    }
+
+private:
+    typedef long double R;
+
+    // inputs of one sweep, unused columns stay zero
+    struct Grid {
+        QVector<double> a, b, c;
+        void add(double x, double y = 0, double z = 0) {
+            a.append(x);
+            b.append(y);
+            c.append(z);
+        }
+        int size() const { return a.size(); }
+    };
+
+    // mismatches are points where only one side is NaN or infinite; the relative error skips
+    // reference values within 1e-9 of zero, where it only measures rounding of the inputs
+    struct Error {
+        int points_{0};
+        int mismatches_{0};
+        double maxAbs_{0};
+        double maxRel_{0};
+
+        void add(double value, R ref) {
+            ++points_;
+            const R err = std::fabs(value - ref);
+            if (!std::isfinite(err)) {
+                if (!(value == ref || (std::isnan(value) && std::isnan(ref)))) ++mismatches_;
+                return;
+            }
+            maxAbs_ = std::max(maxAbs_, double(err));
+            if (std::fabs(ref) >= 1e-9) maxRel_ = std::max(maxRel_, double(err / std::fabs(ref)));
+        }
+
+        QJsonObject toJson() const {
+            QJsonObject ret;
+            ret["points"] = points_;
+            ret["maxError"] = maxAbs_;
+            ret["maxRelError"] = maxRel_;
+            ret["mismatches"] = mismatches_;
+            return ret;
+        }
+    };
+
+    // fastest of rounds runs of body, in ns per item
+    template <typename F> static double fastest(int rounds, int items, F body) {
+        qint64 best = std::numeric_limits<qint64>::max();
+        QElapsedTimer timer;
+        for (int r = 0; r < rounds; ++r) {
+            timer.start();
+            body();
+            best = std::min(best, timer.nsecsElapsed());
+        }
+        return items > 0 ? double(best) / items : 0;
+    }
+
+    // f(a, b, c) against ref(a, b, c), the results are left in out
+    template <typename F, typename Ref>
+    static QJsonObject sweep(const Grid& g, int rounds, QVector<double>& out, F f, Ref ref) {
+        const int n = g.size();
+        const double *a = g.a.constData(), *b = g.b.constData(), *c = g.c.constData();
+        out.resize(n);
+        double* o = out.data();
+        const double ns = fastest(rounds, n, [&] {
+            for (int i = 0; i < n; ++i) o[i] = f(a[i], b[i], c[i]);
+        });
+        Error error;
+        for (int i = 0; i < n; ++i) error.add(o[i], ref(R(a[i]), R(b[i]), R(c[i])));
+        QJsonObject ret = error.toJson();
+        ret["nsPerCall"] = ns;
+        return ret;
+    }
+
+    // a *_n kernel f(a, b, c, out, n) against the scalar results of sweep() and the reference
+    template <typename F, typename Ref>
+    static QJsonObject batched(const Grid& g, int rounds, const QVector<double>& scalar, F f,
+                               Ref ref) {
+        const int n = g.size();
+        const double *a = g.a.constData(), *b = g.b.constData(), *c = g.c.constData();
+        QVector<double> out(n);
+        double* o = out.data();
+        const double ns = fastest(rounds, n, [&] { f(a, b, c, o, size_t(n)); });
+        Error error;
+        double maxUlp = 0;
+        int mismatches = 0;
+        for (int i = 0; i < n; ++i) {
+            error.add(o[i], ref(R(a[i]), R(b[i]), R(c[i])));
+            const double s = scalar[i];
+            if (o[i] == s || (std::isnan(o[i]) && std::isnan(s))) continue;
+            if (!std::isfinite(o[i]) || !std::isfinite(s)) {
+                ++mismatches;
+                continue;
+            }
+            const double ulp = std::nextafter(std::fabs(s), double(INFINITY)) - std::fabs(s);
+            maxUlp = std::max(maxUlp, std::fabs(o[i] - s) / ulp);
+        }
+        QJsonObject ret = error.toJson();
+        ret["nsPerElement"] = ns;
+        ret["maxUlpToScalar"] = maxUlp;
+        ret["scalarMismatches"] = mismatches;
+        return ret;
+    }
+
+    // the correlations of psychropy.c in long double, same units and branches
+
+    static R satPress(R Tdb) {
+        const R TK = Tdb + 273.15L, lnTK = std::log(TK);
+        if (Tdb <= 0) {
+            return std::exp(-5674.5359L / TK + 6.3925247L - 0.009677843L * TK +
+                            0.00000062215701L * TK * TK + 2.0747825E-09L * TK * TK * TK -
+                            9.484024E-13L * TK * TK * TK * TK + 4.1635019L * lnTK) /
+                   1000;
+        }
+        return std::exp(-5800.2206L / TK + 1.3914993L - 0.048640239L * TK +
+                        0.000041764768L * TK * TK - 0.000000014452093L * TK * TK * TK +
+                        6.5459673L * lnTK) /
+               1000;
+    }
+
+    static R partPress(R P, R W) { return P * W / (0.62198L + W); }
+
+    static R humRat(R Tdb, R Twb, R P) {
+        const R Pws = satPress(Twb);
+        const R Ws = 0.62198L * Pws / (P - Pws);
+        if (Tdb >= 0) {
+            return ((2501 - 2.326L * Twb) * Ws - 1.006L * (Tdb - Twb)) /
+                   (2501 + 1.86L * Tdb - 4.186L * Twb);
+        }
+        return ((2830 - 0.24L * Twb) * Ws - 1.006L * (Tdb - Twb)) /
+               (2830 + 1.86L * Tdb - 2.1L * Twb);
+    }
+
+    static R humRat2(R Tdb, R RH, R P) {
+        const R Pws = satPress(Tdb);
+        return 0.62198L * RH * Pws / (P - RH * Pws);
+    }
+
+    static R relHum(R Tdb, R Twb, R P) {
+        return partPress(P, humRat(Tdb, Twb, P)) / satPress(Tdb);
+    }
+
+    static R relHum2(R Tdb, R W, R P) { return partPress(P, W) / satPress(Tdb); }
+
+    // Wet_bulb by bisection to full long double precision, NAN where Wet_bulb_solve reports
+    // PSYCH_EDOMAIN
+    static R wetBulb(R Tdb, R RH, R P) {
+        if (!(RH >= 0 && RH <= 1) || !(Tdb >= -100 && Tdb <= 200) || !(P > satPress(Tdb))) {
+            return NAN;
+        }
+        return wetBulbW(Tdb, humRat2(Tdb, RH, P), P);
+    }
+
+    // the Twb whose Hum_rat is W, as psych() solves it from the state
+    static R wetBulbW(R Tdb, R W, R P) {
+        R lo = -100, hi = Tdb;
+        if (humRat(Tdb, hi, P) <= W) return Tdb;
+        if (humRat(Tdb, lo, P) > W) return NAN;
+        for (;;) {
+            const R mid = (lo + hi) / 2;
+            if (mid <= lo || mid >= hi) return mid;
+            (humRat(Tdb, mid, P) < W ? lo : hi) = mid;
+        }
+    }
+
+    static R enthalpy(R Tdb, R W) { return 1.006L * Tdb + W * (2501 + 1.86L * Tdb); }
+
+    static R tDrybulb(R h, R W) { return (h - 2501 * W) / (1.006L + 1.86L * W); }
+
+    static R dewPointPw(R Pw) {
+        const R alpha = std::log(Pw);
+        const R high = 6.54L + 14.526L * alpha + 0.7389L * alpha * alpha +
+                       0.09486L * alpha * alpha * alpha + 0.4569L * std::pow(Pw, 0.1984L);
+        return high >= 0 ? high : 6.09L + 12.608L * alpha + 0.4959L * alpha * alpha;
+    }
+
+    static R dewPoint(R P, R W) { return dewPointPw(partPress(P, W)); }
+
+    static R density(R P, R Tdb, R W) {
+        return 1000 * P / (287.055L * (273.15L + Tdb) * (1 + 1.6078L * W));
+    }
+
+    static QJsonObject functions(int rounds) {
+        static const double pressures[] = {60, 80, 101.325, 110};
+        QJsonObject ret;
+        QVector<double> out;
+
+        Grid temperatures;  // -100..200 C, the range of Sat_press, in steps of 0.005 C
+        for (int k = -20000; k <= 40000; ++k) temperatures.add(k / 200.0);
+        QJsonObject entry = sweep(temperatures, rounds, out,
+                                  [](double Tdb, double, double) { return Sat_press(Tdb); },
+                                  [](R Tdb, R, R) { return satPress(Tdb); });
+        entry["batched"] = batched(
+                temperatures, rounds, out,
+                [](const double* Tdb, const double*, const double*, double* o, size_t n) {
+                    Sat_press_n(Tdb, o, n);
+                },
+                [](R Tdb, R, R) { return satPress(Tdb); });
+        ret["Sat_press"] = entry;
+
+        Grid humidity;  // P, W up to 0.2 kg/kg
+        for (double P : pressures) {
+            for (int k = 0; k <= 400; ++k) humidity.add(P, k / 2000.0);
+        }
+        entry = sweep(humidity, rounds, out,
+                      [](double P, double W, double) { return Part_press(P, W); },
+                      [](R P, R W, R) { return partPress(P, W); });
+        entry["batched"] = batched(
+                humidity, rounds, out,
+                [](const double* P, const double* W, const double*, double* o, size_t n) {
+                    Part_press_n(P, W, o, n);
+                },
+                [](R P, R W, R) { return partPress(P, W); });
+        ret["Part_press"] = entry;
+
+        Grid wetBulbs;  // Tdb -50..90 C, Twb up to 30 C below, P
+        for (double P : pressures) {
+            for (int t = -100; t <= 180; ++t) {
+                for (int d = 0; d <= 60; ++d) wetBulbs.add(t / 2.0, (t - d) / 2.0, P);
+            }
+        }
+        entry = sweep(wetBulbs, rounds, out,
+                      [](double Tdb, double Twb, double P) { return Hum_rat(Tdb, Twb, P); },
+                      [](R Tdb, R Twb, R P) { return humRat(Tdb, Twb, P); });
+        entry["batched"] = batched(
+                wetBulbs, rounds, out,
+                [](const double* Tdb, const double* Twb, const double* P, double* o, size_t n) {
+                    Hum_rat_n(Tdb, Twb, P, o, n);
+                },
+                [](R Tdb, R Twb, R P) { return humRat(Tdb, Twb, P); });
+        ret["Hum_rat"] = entry;
+
+        entry = sweep(wetBulbs, rounds, out,
+                      [](double Tdb, double Twb, double P) { return Rel_hum(Tdb, Twb, P); },
+                      [](R Tdb, R Twb, R P) { return relHum(Tdb, Twb, P); });
+        entry["batched"] = batched(
+                wetBulbs, rounds, out,
+                [](const double* Tdb, const double* Twb, const double* P, double* o, size_t n) {
+                    Rel_hum_n(Tdb, Twb, P, o, n);
+                },
+                [](R Tdb, R Twb, R P) { return relHum(Tdb, Twb, P); });
+        ret["Rel_hum"] = entry;
+
+        Grid relative;  // Tdb -100..200 C, RH 0..1, where the vapor stays below P
+        for (double P : pressures) {
+            for (int t = -200; t <= 400; ++t) {
+                for (int r = 0; r <= 20; ++r) {
+                    if (r / 20.0L * satPress(t / 2.0L) < P) relative.add(t / 2.0, r / 20.0, P);
+                }
+            }
+        }
+        entry = sweep(relative, rounds, out,
+                      [](double Tdb, double RH, double P) { return Hum_rat2(Tdb, RH, P); },
+                      [](R Tdb, R RH, R P) { return humRat2(Tdb, RH, P); });
+        entry["batched"] = batched(
+                relative, rounds, out,
+                [](const double* Tdb, const double* RH, const double* P, double* o, size_t n) {
+                    Hum_rat2_n(Tdb, RH, P, o, n);
+                },
+                [](R Tdb, R RH, R P) { return humRat2(Tdb, RH, P); });
+        ret["Hum_rat2"] = entry;
+
+        Grid ratios;  // Tdb -100..200 C, W up to 0.2 kg/kg, P
+        for (double P : pressures) {
+            for (int t = -20; t <= 40; ++t) {
+                for (int w = 0; w <= 40; ++w) ratios.add(t * 5.0, w / 200.0, P);
+            }
+        }
+        entry = sweep(ratios, rounds, out,
+                      [](double Tdb, double W, double P) { return Rel_hum2(Tdb, W, P); },
+                      [](R Tdb, R W, R P) { return relHum2(Tdb, W, P); });
+        entry["batched"] = batched(
+                ratios, rounds, out,
+                [](const double* Tdb, const double* W, const double* P, double* o, size_t n) {
+                    Rel_hum2_n(Tdb, W, P, o, n);
+                },
+                [](R Tdb, R W, R P) { return relHum2(Tdb, W, P); });
+        ret["Rel_hum2"] = entry;
+
+        entry = sweep(ratios, rounds, out,
+                      [](double Tdb, double W, double) { return Enthalpy_Air_H2O(Tdb, W); },
+                      [](R Tdb, R W, R) { return enthalpy(Tdb, W); });
+        entry["batched"] = batched(
+                ratios, rounds, out,
+                [](const double* Tdb, const double* W, const double*, double* o, size_t n) {
+                    Enthalpy_Air_H2O_n(Tdb, W, o, n);
+                },
+                [](R Tdb, R W, R) { return enthalpy(Tdb, W); });
+        ret["Enthalpy_Air_H2O"] = entry;
+
+        entry = sweep(ratios, rounds, out,
+                      [](double Tdb, double W, double P) { return Dry_Air_Density(P, Tdb, W); },
+                      [](R Tdb, R W, R P) { return density(P, Tdb, W); });
+        entry["batched"] = batched(
+                ratios, rounds, out,
+                [](const double* Tdb, const double* W, const double* P, double* o, size_t n) {
+                    Dry_Air_Density_n(P, Tdb, W, o, n);
+                },
+                [](R Tdb, R W, R P) { return density(P, Tdb, W); });
+        ret["Dry_Air_Density"] = entry;
+
+        Grid enthalpies;  // h -200..600 kJ/kg, W up to 0.2 kg/kg
+        for (int h = -40; h <= 120; ++h) {
+            for (int w = 0; w <= 40; ++w) enthalpies.add(h * 5.0, w / 200.0);
+        }
+        entry = sweep(enthalpies, rounds, out,
+                      [](double h, double W, double) { return T_drybulb_calc(h, W); },
+                      [](R h, R W, R) { return tDrybulb(h, W); });
+        entry["batched"] = batched(
+                enthalpies, rounds, out,
+                [](const double* h, const double* W, const double*, double* o, size_t n) {
+                    T_drybulb_calc_n(h, W, o, n);
+                },
+                [](R h, R W, R) { return tDrybulb(h, W); });
+        ret["T_drybulb_calc"] = entry;
+
+        Grid dewPoints;  // W from 1e-8 to 10 kg/kg in 1/64 decades, the span of the dew tables
+        for (double P : pressures) {
+            for (int k = -8 * 64; k <= 64; ++k) dewPoints.add(P, std::pow(10.0, k / 64.0));
+        }
+        entry = sweep(dewPoints, rounds, out,
+                      [](double P, double W, double) { return Dew_point(P, W); },
+                      [](R P, R W, R) { return dewPoint(P, W); });
+        entry["batched"] = batched(
+                dewPoints, rounds, out,
+                [](const double* P, const double* W, const double*, double* o, size_t n) {
+                    Dew_point_n(P, W, o, n);
+                },
+                [](R P, R W, R) { return dewPoint(P, W); });
+        ret["Dew_point"] = entry;
+
+        ret["Wet_bulb"] = wetBulbReport(relative, rounds);
+        return ret;
+    }
+
+    // Wet_bulb accuracy plus the iteration counts of Wet_bulb_solve from a cold start and of
+    // Wet_bulb_next along a slowly drifting channel
+    static QJsonObject wetBulbReport(const Grid& g, int rounds) {
+        QVector<double> out;
+        QJsonObject ret = sweep(g, rounds, out,
+                                [](double Tdb, double RH, double P) {
+                                    return Wet_bulb(Tdb, RH, P);
+                                },
+                                [](R Tdb, R RH, R P) { return wetBulb(Tdb, RH, P); });
+        ret["batched"] = batched(
+                g, rounds, out,
+                [](const double* Tdb, const double* RH, const double* P, double* o, size_t n) {
+                    Wet_bulb_n(Tdb, RH, P, o, n);
+                },
+                [](R Tdb, R RH, R P) { return wetBulb(Tdb, RH, P); });
+
+        int maxIterations = 0, failures = 0, noConvergence = 0;
+        double total = 0;
+        for (int i = 0; i < g.size(); ++i) {
+            double Twb = 0;
+            int iterations = 0;
+            const int status = Wet_bulb_solve(g.a[i], g.b[i], g.c[i], NAN, &Twb, &iterations);
+            maxIterations = std::max(maxIterations, iterations);
+            total += iterations;
+            if (status == PSYCH_ENOCONV) ++noConvergence;
+            if (status != PSYCH_OK && !std::isnan(wetBulb(g.a[i], g.b[i], g.c[i]))) ++failures;
+        }
+        QJsonObject cold;
+        cold["max"] = maxIterations;
+        cold["mean"] = g.size() > 0 ? total / g.size() : 0;
+        cold["failures"] = failures;
+        cold["noConvergence"] = noConvergence;
+        ret["iterations"] = cold;
+
+        const int samples = 10000;
+        psych_wet_bulb_stream stream;
+        psych_wet_bulb_stream_init(&stream);
+        maxIterations = 0;
+        total = 0;
+        for (int k = 0; k < samples; ++k) {
+            Wet_bulb_next(&stream, 25 + 5 * std::sin(k / 100.0), 0.5 + 0.3 * std::sin(k / 70.0),
+                          101.325);
+            maxIterations = std::max(maxIterations, stream.iterations);
+            total += stream.iterations;
+        }
+        QJsonObject warm;
+        warm["max"] = maxIterations;
+        warm["mean"] = total / samples;
+        ret["streamIterations"] = warm;
+        return ret;
+    }
+
+    static R imperialPressure() { return 4.4482216152605L / (0.0254L * 0.0254L * 1000); }
+
+    // plan input in the given units to SI, as input_conversion() of psychropy.c
+    static R toSI(psych_qty qty, R value, bool imperial) {
+        if (!imperial) return value;
+        if (qty == PSYCH_TDB || qty == PSYCH_TWB || qty == PSYCH_DP) return (value - 32) / 1.8L;
+        if (qty == PSYCH_H) return value * 1.055056L / 0.45359237L - 17.884444444L;
+        return value;
+    }
+
+    static R fromSI(psych_qty qty, R value, bool imperial) {
+        if (!imperial) return value;
+        if (qty == PSYCH_TDB || qty == PSYCH_TWB || qty == PSYCH_DP) return value * 1.8L + 32;
+        if (qty == PSYCH_H) return (value + 17.884444444L) * 0.45359237L / 1.055056L;
+        return value;
+    }
+
+    // SI results to the output units, IMP_SCALE and IMP_OFFSET of psychropy.c
+    static R output(psych_qty qty, R value, bool imperial) {
+        if (!imperial) return value;
+        const R ft3 = (12 * 0.0254L) * (12 * 0.0254L) * (12 * 0.0254L);
+        switch (qty) {
+            case PSYCH_TDB:
+            case PSYCH_TWB:
+            case PSYCH_DP:
+                return value * 1.8L + 32;
+            case PSYCH_WVP:
+                return value * (0.0254L * 0.0254L / 4.448230531L);
+            case PSYCH_H:
+                return (value + 17.88444444444L) * 0.45359237L / 1.055056L;
+            case PSYCH_SV:
+                return value * 0.45359265L / ft3;
+            case PSYCH_MAD:
+                return value * ft3 / 0.45359265L;
+            default:
+                return value;
+        }
+    }
+
+    // evaluate() of psychropy.c: SI inputs, P in kPa, an SI result
+    static R state(psych_qty in0, R v0, psych_qty in1, R v1, R P, psych_qty out) {
+        if (out == in0) return v0;
+        if (out == in1) return v1;
+        R Tdb = 0, W = 0;
+        if (in0 == PSYCH_TDB) {
+            Tdb = v0;
+            switch (in1) {
+                case PSYCH_TWB:
+                    W = humRat(Tdb, v1, P);
+                    break;
+                case PSYCH_DP:
+                    W = 0.621945L * satPress(v1) / (P - satPress(v1));
+                    break;
+                case PSYCH_RH:
+                    W = humRat2(Tdb, v1, P);
+                    break;
+                case PSYCH_W:
+                    W = v1;
+                    break;
+                default:
+                    W = (v1 - 1.006L * Tdb) / (2501 + 1.86L * Tdb);
+                    break;
+            }
+        } else if (in0 == PSYCH_W) {
+            W = v0;
+            Tdb = in1 == PSYCH_TDB ? v1 : tDrybulb(v1, W);
+        } else if (in1 == PSYCH_TDB) {
+            Tdb = v1;
+            W = (v0 - 1.006L * Tdb) / (2501 + 1.86L * Tdb);
+        } else {
+            W = v1;
+            Tdb = tDrybulb(v0, W);
+        }
+
+        const R Pws = satPress(Tdb), Pw = partPress(P, W);
+        const R RH = in1 == PSYCH_RH ? v1 : in1 == PSYCH_DP ? satPress(v1) / Pws : Pw / Pws;
+        switch (out) {
+            case PSYCH_TDB:
+                return Tdb;
+            case PSYCH_TWB:
+                return wetBulbW(Tdb, W, P);
+            case PSYCH_DP:
+                return dewPointPw(Pw);
+            case PSYCH_RH:
+                return RH;
+            case PSYCH_W:
+                return W;
+            case PSYCH_WVP:
+                return Pw * 1000;
+            case PSYCH_DSAT:
+                return W / (0.62198L * Pws / (P - Pws));
+            case PSYCH_H:
+                return enthalpy(Tdb, W);
+            case PSYCH_SV:
+                return 1 / density(P, Tdb, W);
+            default:
+                return density(P, Tdb, W) * (1 + W);
+        }
+    }
+
+    // every accepted input pair and output over states from -17.5..57.5 C, off the 0 C branch
+    // points of the correlations, 5..95 % RH and two pressures, through a plan and through
+    // psych(). psych() is checked against its legacy unitType rules: inputs are SI only for
+    // "SI", the output is Imperial unless it is "Imp", so "SI" gives Imperial results, "Imp"
+    // SI ones and an unknown unit Imperial ones; entropy is NAN. The plan gives its output in
+    // the input units, it is not run for entropy or the unknown unit.
+    static QJsonObject combinations(int rounds) {
+        static const char* const names[PSYCH_QTY_COUNT] = {
+                "Tdb", "Twb", "DP", "RH", "W", "WVP", "DSat", "h", "s", "SV", "MAD"};
+        static const psych_qty pairs[][2] = {
+                {PSYCH_TDB, PSYCH_TWB}, {PSYCH_TDB, PSYCH_DP}, {PSYCH_TDB, PSYCH_RH},
+                {PSYCH_TDB, PSYCH_W},   {PSYCH_TDB, PSYCH_H},  {PSYCH_W, PSYCH_TDB},
+                {PSYCH_W, PSYCH_H},     {PSYCH_H, PSYCH_TDB},  {PSYCH_H, PSYCH_W}};
+        static const char* const units[] = {"SI", "Imp", "si"};
+
+        // SI reference states, indexed by psych_qty, P in kPa
+        QVector<QVector<R>> states;
+        for (R P : {80.0L, 101.325L}) {
+            for (R t = -17.5L; t < 60; t += 5) {
+                for (int r = 5; r <= 95; r += 10) {
+                    QVector<R> s(PSYCH_QTY_COUNT + 1);
+                    s[PSYCH_TDB] = t;
+                    s[PSYCH_RH] = r / 100.0L;
+                    s[PSYCH_W] = humRat2(t, s[PSYCH_RH], P);
+                    s[PSYCH_TWB] = wetBulb(t, s[PSYCH_RH], P);
+                    s[PSYCH_DP] = dewPoint(P, s[PSYCH_W]);
+                    s[PSYCH_H] = enthalpy(t, s[PSYCH_W]);
+                    s[PSYCH_QTY_COUNT] = P;
+                    states.append(s);
+                }
+            }
+        }
+        const int n = states.size();
+
+        QJsonArray list;
+        // psych() over every combination, against the legacy rules
+        Error legacyAll;
+        for (int u = 0; u < 3; ++u) {
+            const bool imperial = qstrcmp(units[u], "SI") != 0;
+            const bool imperialOut = qstrcmp(units[u], "Imp") != 0;
+            const R pScale = imperial ? imperialPressure() : 0.001L;
+            for (const auto& pair : pairs) {
+                QVector<double> P(n), in0(n), in1(n);
+                for (int i = 0; i < n; ++i) {
+                    P[i] = double(states[i][PSYCH_QTY_COUNT] / pScale);
+                    in0[i] = double(fromSI(pair[0], states[i][pair[0]], imperial));
+                    in1[i] = double(fromSI(pair[1], states[i][pair[1]], imperial));
+                }
+                for (int q = 0; q < PSYCH_QTY_COUNT; ++q) {
+                    const psych_qty out = psych_qty(q);
+                    const char *n0 = names[pair[0]], *n1 = names[pair[1]], *no = names[q];
+                    QVector<double> legacy(n), result(n);
+                    double *l = legacy.data(), *o = result.data();
+                    const double ns = fastest(rounds, n, [&] {
+                        for (int i = 0; i < n; ++i) {
+                            l[i] = ::psych(P[i], n0, in0[i], n1, in1[i], no, units[u]);
+                        }
+                    });
+                    QVector<R> ref(n);
+                    for (int i = 0; i < n; ++i) {
+                        ref[i] = out == PSYCH_S
+                                         ? R(NAN)
+                                         : state(pair[0], toSI(pair[0], in0[i], imperial),
+                                                 pair[1], toSI(pair[1], in1[i], imperial),
+                                                 P[i] * pScale, out);
+                    }
+                    Error psychError;
+                    for (int i = 0; i < n; ++i) {
+                        psychError.add(l[i], output(out, ref[i], imperialOut));
+                        legacyAll.add(l[i], output(out, ref[i], imperialOut));
+                    }
+
+                    QJsonObject entry;
+                    if (out != PSYCH_S && u < 2) {
+                        psych_plan plan;
+                        psych_plan_init(&plan, pair[0], pair[1], out,
+                                        imperial ? PSYCH_IMP : PSYCH_SI);
+                        const double nsPlan = fastest(rounds, n, [&] {
+                            psych_eval_n(&plan, P.constData(), in0.constData(), in1.constData(),
+                                         o, size_t(n));
+                        });
+                        Error error;
+                        for (int i = 0; i < n; ++i) error.add(o[i], output(out, ref[i], imperial));
+                        entry = error.toJson();
+                        entry["nsPerEval"] = nsPlan;
+                    }
+                    entry["in0"] = n0;
+                    entry["in1"] = n1;
+                    entry["out"] = no;
+                    entry["units"] = units[u];
+                    entry["nsPerCall"] = ns;
+                    entry["psych"] = psychError.toJson();
+                    list.append(entry);
+                }
+            }
+        }
+
+        QJsonObject ret;
+        ret["combinations"] = list;
+        ret["psych"] = legacyAll.toJson();
+        return ret;
+    }
+
+    // DensityModel on noise-free samples of known coefficients, x1 in 20..40 and x2 in 0..100,
+    // and the drift of update() from a refit once noise is added
+    static QJsonArray densityModel(int rounds) {
+        static const int pick[DensityModel::ModelCount][DensityModel::MaxTerms] = {
+                {0, 5}, {1, 5}, {0, 2, 5}, {1, 3, 5}, {0, 1, 5}, {0, 1, 2, 3, 4, 5}};
+        static const int terms[DensityModel::ModelCount] = {2, 2, 3, 3, 3, 6};
+        static const R truth[DensityModel::MaxTerms] = {-0.35L, 0.42L,   -0.0041L,
+                                                        0.0012L, 0.0007L, 1003.5L};
+        const int n = 2000;
+        QVector<double> x1(n), x2(n), y(n), noisy(n), out(n);
+        QVector<R> exact(n);
+        QJsonArray ret;
+        for (int m = 0; m < DensityModel::ModelCount; ++m) {
+            for (int k = 0; k < n; ++k) {  // low discrepancy points over the domain
+                const R a = 20 + 20 * std::fmod(k * 0.6180339887498949L, 1.0L);
+                const R b = 100 * std::fmod(k * 0.7548776662466927L, 1.0L);
+                const R phi[DensityModel::MaxTerms] = {a, b, a * a, b * b, a * b, 1};
+                x1[k] = double(a);
+                x2[k] = double(b);
+                exact[k] = 0;
+                for (int t = 0; t < terms[m]; ++t) exact[k] += truth[pick[m][t]] * phi[pick[m][t]];
+                y[k] = double(exact[k]);
+                noisy[k] = y[k] + 0.05 * std::sin(1.7 * k);
+            }
+
+            DensityModel model;
+            QJsonObject entry;
+            entry["model"] = m;
+            entry["samples"] = n;
+            bool fitted = true;
+            entry["fitNsPerSample"] = fastest(rounds, n, [&] {
+                fitted &= model.formula(m, x1.constData(), x2.constData(), y.constData(), n);
+            });
+            entry["fitted"] = fitted;
+            const QVector<double> coeff = model.coefficients();
+            double coeffErr = 0;
+            for (int t = 0; t < coeff.size(); ++t) {
+                const R expected = truth[pick[m][t]];
+                coeffErr = std::max(coeffErr, double(std::fabs((coeff[t] - expected) / expected)));
+            }
+            entry["maxCoefficientRelError"] = coeffErr;
+            entry["densityNsPerCall"] = fastest(rounds, n, [&] {
+                model.density(x1.constData(), x2.constData(), out.data(), n);
+            });
+            Error error;
+            for (int k = 0; k < n; ++k) error.add(out[k], exact[k]);
+            entry["density"] = error.toJson();
+
+            // first half fitted, second half by update(), against a fit of all samples
+            const int half = n / 2;
+            qint64 best = std::numeric_limits<qint64>::max();
+            QElapsedTimer timer;
+            for (int r = 0; r < rounds; ++r) {
+                model.formula(m, x1.constData(), x2.constData(), noisy.constData(), half);
+                timer.start();
+                for (int k = half; k < n; ++k) model.update(x1[k], x2[k], noisy[k]);
+                best = std::min(best, timer.nsecsElapsed());
+            }
+            entry["updateNsPerSample"] = double(best) / (n - half);
+            const QVector<double> online = model.coefficients();
+            model.formula(m, x1.constData(), x2.constData(), noisy.constData(), n);
+            const QVector<double> refit = model.coefficients();
+            double drift = 0;
+            for (int t = 0; t < refit.size() && t < online.size(); ++t) {
+                drift = std::max(drift, std::fabs(online[t] - refit[t]) / std::fabs(refit[t]));
+            }
+            entry["updateDrift"] = drift;
+            ret.append(entry);
+        }
+        return ret;
+    }
+};
+
+#endif  // BENCHMARK_HPP
@@ -0,0 +1,219 @@
+#ifndef DENSITYMODEL_HPP
+#define DENSITYMODEL_HPP
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// native replacement for scipy_cell.py: the same six density models, linear in their
+// coefficients, fitted by least squares instead of curve_fit and updated online by
+// recursive least squares as samples arrive
+class DensityModel {
+public:
+    enum { ModelCount = 6, MaxTerms = 6 };
+
+    // formula(i, x1, x2, y) of scipy_cell.py: i picks func1..func6 as 0..5, false if i is out
+    // of range or the samples leave a coefficient undetermined; the previous fit is kept then
+    bool formula(int i, const QVector<double>& x1, const QVector<double>& x2,
+                 const QVector<double>& y) {
+        if (x1.size() != y.size() || x2.size() != y.size()) return false;
+        return formula(i, x1.constData(), x2.constData(), y.constData(), y.size());
+    }
+
+    bool formula(int i, const double* x1, const double* x2, const double* y, int n) {
+        const int p = terms(i);
+        if (p == 0 || n < p) return false;
+
+        // Householder QR of the n x p design matrix, column-major, applied to y as well
+        std::vector<double> a(n * p), b(y, y + n);
+        for (int r = 0; r < n; ++r) {
+            double phi[MaxTerms];
+            basis(i, x1[r], x2[r], phi);
+            for (int c = 0; c < p; ++c) a[c * n + r] = phi[c];
+        }
+        double scale = 0;
+        for (int k = 0; k < p; ++k) {
+            double* col = &a[k * n];
+            double norm = 0;
+            for (int r = k; r < n; ++r) norm += col[r] * col[r];
+            norm = std::sqrt(norm);
+            scale = std::max(scale, norm);
+            if (norm <= 1e-13 * scale) return false;  // column dependent on the previous ones
+            const double alpha = col[k] > 0 ? -norm : norm;
+            const double v0 = col[k] - alpha;  // v = (v0, col[k + 1..n)), H = I - 2 v v' / v'v
+            const double vv = v0 * v0 + norm * norm - col[k] * col[k];
+            col[k] = alpha;
+            for (int c = k + 1; c <= p; ++c) {
+                double* other = c < p ? &a[c * n] : b.data();
+                double dot = v0 * other[k];
+                for (int r = k + 1; r < n; ++r) dot += col[r] * other[r];
+                const double f = 2 * dot / vv;
+                other[k] -= f * v0;
+                for (int r = k + 1; r < n; ++r) other[r] -= f * col[r];
+            }
+        }
+
+        // R c = Q'y, and the RLS covariance (R'R)^-1 = R^-1 R^-T
+        double rinv[MaxTerms][MaxTerms] = {};
+        for (int k = p - 1; k >= 0; --k) {
+            double sum = b[k];
+            for (int c = k + 1; c < p; ++c) sum -= a[c * n + k] * coeff_[c];
+            coeff_[k] = sum / a[k * n + k];
+            rinv[k][k] = 1 / a[k * n + k];
+            for (int c = k + 1; c < p; ++c) {
+                double s = 0;
+                for (int m = k + 1; m <= c; ++m) s += a[m * n + k] * rinv[m][c];
+                rinv[k][c] = -s / a[k * n + k];
+            }
+        }
+        for (int r = 0; r < p; ++r) {
+            for (int c = 0; c < p; ++c) {
+                double s = 0;
+                for (int m = std::max(r, c); m < p; ++m) s += rinv[r][m] * rinv[c][m];
+                cov_[r][c] = s;
+            }
+        }
+        model_ = i;
+        return true;
+    }
+
+    // starts model i from zero coefficients for update() alone, with a covariance of delta I
+    bool reset(int i, double delta = 1e6) {
+        const int p = terms(i);
+        if (p == 0) return false;
+        model_ = i;
+        for (int r = 0; r < MaxTerms; ++r) {
+            coeff_[r] = 0;
+            for (int c = 0; c < MaxTerms; ++c) cov_[r][c] = r == c && r < p ? delta : 0;
+        }
+        return true;
+    }
+
+    // one recursive least squares step, samples are discounted by lambda per update; after
+    // formula() and with lambda 1 the result equals a refit on all samples so far
+    bool update(double x1, double x2, double y) {
+        const int p = terms(model_);
+        if (p == 0) return false;
+        double phi[MaxTerms], pphi[MaxTerms];
+        basis(model_, x1, x2, phi);
+        double denom = lambda_, err = y;
+        for (int r = 0; r < p; ++r) {
+            pphi[r] = 0;
+            for (int c = 0; c < p; ++c) pphi[r] += cov_[r][c] * phi[c];
+            denom += phi[r] * pphi[r];
+            err -= phi[r] * coeff_[r];
+        }
+        for (int r = 0; r < p; ++r) coeff_[r] += pphi[r] / denom * err;
+        for (int r = 0; r < p; ++r) {
+            for (int c = r; c < p; ++c) {  // kept symmetric
+                cov_[r][c] = (cov_[r][c] - pphi[r] * pphi[c] / denom) / lambda_;
+                cov_[c][r] = cov_[r][c];
+            }
+        }
+        return true;
+    }
+
+    // lambda in (0, 1] as load() accepts it, anything else is refused and the previous one stays
+    bool setForgetting(double lambda) {
+        if (!(lambda > 0 && lambda <= 1)) return false;
+        lambda_ = lambda;
+        return true;
+    }
+    double forgetting() const { return lambda_; }
+
+    // density(x) of scipy_cell.py, NaN before the first fit
+    double density(double x1, double x2) const {
+        const int p = terms(model_);
+        if (p == 0) return NAN;
+        double phi[MaxTerms], result = 0;
+        basis(model_, x1, x2, phi);
+        for (int k = 0; k < p; ++k) result += coeff_[k] * phi[k];
+        return result;
+    }
+
+    void density(const double* x1, const double* x2, double* out, int n) const {
+        for (int k = 0; k < n; ++k) out[k] = density(x1[k], x2[k]);
+    }
+
+    QVector<double> density(const QVector<double>& x1, const QVector<double>& x2) const {
+        QVector<double> out(std::min(x1.size(), x2.size()));
+        density(x1.constData(), x2.constData(), out.data(), out.size());
+        return out;
+    }
+
+    // -1 before the first fit
+    int model() const { return model_; }
+
+    // popt of scipy_cell.py, in the argument order of the model function
+    QVector<double> coefficients() const {
+        QVector<double> result;
+        for (int k = 0; k < terms(model_); ++k) result.append(coeff_[k]);
+        return result;
+    }
+
+    bool save(const QString& path) const {
+        const int p = terms(model_);
+        if (p == 0) return false;
+        QJsonArray coeff, cov;
+        for (int r = 0; r < p; ++r) {
+            coeff.append(coeff_[r]);
+            for (int c = 0; c < p; ++c) cov.append(cov_[r][c]);
+        }
+        QJsonObject root;
+        root["model"] = model_;
+        root["coefficients"] = coeff;
+        root["covariance"] = cov;
+        root["lambda"] = lambda_;
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+        return file.write(QJsonDocument(root).toJson()) > 0;
+    }
+
+    // the covariance is optional, update() then restarts from reset()'s; so is lambda, files
+    // from before it was saved were written with the default of 1
+    bool load(const QString& path) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) return false;
+        const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+        const int i = root["model"].toInt(-1);
+        const QJsonArray coeff = root["coefficients"].toArray();
+        const QJsonArray cov = root["covariance"].toArray();
+        const double lambda = root["lambda"].toDouble(1);
+        const int p = terms(i);
+        if (p == 0 || coeff.size() != p || (!cov.isEmpty() && cov.size() != p * p)) return false;
+        if (!(lambda > 0 && lambda <= 1)) return false;
+        reset(i);
+        lambda_ = lambda;
+        for (int r = 0; r < p; ++r) {
+            coeff_[r] = coeff.at(r).toDouble();
+            for (int c = 0; c < p && !cov.isEmpty(); ++c) cov_[r][c] = cov.at(r * p + c).toDouble();
+        }
+        return true;
+    }
+
+private:
+    static int terms(int model) {
+        static const int count[ModelCount] = {2, 2, 3, 3, 3, 6};
+        return model >= 0 && model < ModelCount ? count[model] : 0;
+    }
+
+    // regressors of func1..func6 in the order of their coefficients
+    static void basis(int model, double x1, double x2, double* phi) {
+        static const int pick[ModelCount][MaxTerms] = {
+                {0, 5}, {1, 5}, {0, 2, 5}, {1, 3, 5}, {0, 1, 5}, {0, 1, 2, 3, 4, 5}};
+        const double all[MaxTerms] = {x1, x2, x1 * x1, x2 * x2, x1 * x2, 1};
+        for (int k = 0; k < terms(model); ++k) phi[k] = all[pick[model][k]];
+    }
+
+    int model_{-1};
+    double lambda_{1};
+    double coeff_[MaxTerms]{};
+    double cov_[MaxTerms][MaxTerms]{};
+};
+
+#endif  // DENSITYMODEL_HPP
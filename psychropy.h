@@ -1,6 +1,8 @@
 #ifndef PSYCHROPY_H
 #define PSYCHROPY_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -17,6 +19,103 @@ double Dew_point(double P, double W);
 double Dry_Air_Density(double P, double Tdb, double W);
 double psych(double P, const char *in0Type, double in0Val, const char *in1Type,
              double in1Val, const char *outType, const char *unitType);
+
+
+/* Sat_press and Dew_point from the reference formulas or from Chebyshev
+   tables, see psychropy.c; may be switched while other threads evaluate */
+typedef enum {
+    PSYCH_ACCURACY_REFERENCE,  // default
+    PSYCH_ACCURACY_HIGH,       // Sat_press within 1e-12 relative, Dew_point 1e-10 C
+    PSYCH_ACCURACY_FAST        // Sat_press within 2e-7 relative, Dew_point 1e-6 C
+} psych_accuracy;
+void psych_set_accuracy(psych_accuracy mode);
+psych_accuracy psych_get_accuracy(void);
+void psych_accuracy_error(psych_accuracy mode, double *satPressRel, double *dewPointAbs);
+
+/* Wet_bulb with an iteration bound and error reporting, see psychropy.c */
+#define PSYCH_WET_BULB_MAX_ITER 50
+enum { PSYCH_OK = 0, PSYCH_EDOMAIN = -1, PSYCH_ENOCONV = -2 };
+int Wet_bulb_solve(double Tdb, double RH, double P, double guess, double *Twb,
+                   int *iterations);
+
+/* warm-started Wet_bulb over consecutive samples of one channel */
+typedef struct {
+    double Twb;      // last result, the next starting point
+    int iterations;  // of the last call
+    int status;      // of the last call
+} psych_wet_bulb_stream;
+void psych_wet_bulb_stream_init(psych_wet_bulb_stream *stream);
+double Wet_bulb_next(psych_wet_bulb_stream *stream, double Tdb, double RH, double P);
+
+/* psych() inputs and outputs, in psych() order */
+typedef enum {
+    PSYCH_TDB,   // dry bulb temperature [C | F]
+    PSYCH_TWB,   // wet bulb temperature [C | F]
+    PSYCH_DP,    // dew point [C | F]
+    PSYCH_RH,    // relative humidity [fraction]
+    PSYCH_W,     // humidity ratio [kg/kg dry air]
+    PSYCH_WVP,   // water vapor partial pressure [Pa | psi]
+    PSYCH_DSAT,  // degree of saturation
+    PSYCH_H,     // enthalpy [kJ/kg | Btu/lb]
+    PSYCH_S,     // entropy, not available
+    PSYCH_SV,    // specific volume [m3/kg | ft3/lb]
+    PSYCH_MAD,   // moist air density [kg/m3 | lb/ft3]
+    PSYCH_QTY_COUNT
+} psych_qty;
+
+typedef enum { PSYCH_SI, PSYCH_IMP } psych_units;  // ambient pressure in Pa or psi
+
+/* a psych() combination resolved once, evaluated without string handling */
+typedef struct {
+    psych_qty in0, in1, out;
+    double pScale;  // ambient pressure to kPa
+    double inScale[2], inOffset[2];
+    double outScale, outOffset;
+} psych_plan;
+
+/* 0 on success, -1 if the inputs do not fix the state (in0 is Tdb, W or h,
+   in1 one of Tdb, Twb, DP, RH, W, h other than in0, W and h only with Tdb
+   or each other) or out is the unavailable entropy */
+int psych_plan_init(psych_plan *plan, psych_qty in0, psych_qty in1, psych_qty out,
+                    psych_units units);
+int psych_plan_parse(psych_plan *plan, const char *in0Type, const char *in1Type,
+                     const char *outType, const char *unitType);
+int psych_qty_from_name(const char *name);
+double psych_eval(const psych_plan *plan, double P, double in0Val, double in1Val);
+void psych_eval_n(const psych_plan *plan, const double *P, const double *in0Val,
+                  const double *in1Val, double *out, size_t n);
+
+/* every psych() output of one reading in a single pass; quantities not in
+   mask are skipped and left NAN, the inputs are always included */
+#define PSYCH_MASK(qty) (1u << (qty))
+#define PSYCH_ALL (((1u << PSYCH_QTY_COUNT) - 1) & ~PSYCH_MASK(PSYCH_S))
+typedef struct {
+    unsigned mask;                  // quantities present in value
+    double value[PSYCH_QTY_COUNT];  // indexed by psych_qty, in the requested units
+} psych_values;
+
+int psych_state(double P, psych_qty in0, double in0Val, psych_qty in1, double in1Val,
+                psych_units units, unsigned mask, psych_values *values);
+int psych_state_n(const double *P, psych_qty in0, const double *in0Val, psych_qty in1,
+                  const double *in1Val, psych_units units, unsigned mask,
+                  psych_values *values, size_t n);
+
+/* batched forms, out[i] = f(in[i], ...) for i < n; the vectorised saturation
+   pressure stays within PSYCHROPY_N_ULP ulp of Sat_press, the other kernels carry
+   that relative error through their formulas (Dew_point_n within 1e-13 C) */
+#define PSYCHROPY_N_ULP 128
+void Part_press_n(const double *P, const double *W, double *out, size_t n);
+void Sat_press_n(const double *Tdb, double *out, size_t n);
+void Hum_rat_n(const double *Tdb, const double *Twb, const double *P, double *out, size_t n);
+void Hum_rat2_n(const double *Tdb, const double *RH, const double *P, double *out, size_t n);
+void Rel_hum_n(const double *Tdb, const double *Twb, const double *P, double *out, size_t n);
+void Rel_hum2_n(const double *Tdb, const double *W, const double *P, double *out, size_t n);
+void Wet_bulb_n(const double *Tdb, const double *RH, const double *P, double *out, size_t n);
+void Enthalpy_Air_H2O_n(const double *Tdb, const double *W, double *out, size_t n);
+void T_drybulb_calc_n(const double *h, const double *W, double *out, size_t n);
+void Dew_point_n(const double *P, const double *W, double *out, size_t n);
+void Dry_Air_Density_n(const double *P, const double *Tdb, const double *W, double *out,
+                       size_t n);
 #ifdef __cplusplus
 }
 #endif
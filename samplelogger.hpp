@@ -0,0 +1,323 @@
+#ifndef SAMPLELOGGER_HPP
+#define SAMPLELOGGER_HPP
+
+#include <unistd.h>
+#include <QDataStream>
+#include <QFile>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+
+#include "worm.hpp"
+
+namespace WORM {
+
+// multi-producer single-consumer queue, Vyukov's intrusive node design
+template <typename T> class MpscQueue {
+    struct Node {
+        std::atomic<Node*> next_{nullptr};
+        T value_;
+    };
+
+public:
+    MpscQueue() : head_(new Node), tail_(head_.load()) {}
+    ~MpscQueue() {
+        T t;
+        while (pop(t)) {}
+        delete tail_;
+    }
+
+    void push(const T& t) {
+        Node* node = new Node;
+        node->value_ = t;
+        Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next_.store(node, std::memory_order_release);
+    }
+
+    // consumer side only
+    bool pop(T& t) {
+        Node* next = tail_->next_.load(std::memory_order_acquire);
+        if (!next) return false;
+        t = std::move(next->value_);
+        delete tail_;
+        tail_ = next;
+        return true;
+    }
+
+private:
+    std::atomic<Node*> head_;
+    Node* tail_;
+};
+
+// write-behind logger: acquisition threads call log(), one thread group-commits
+// batches through QueryHelper::bulk and spills them to a file while the database is down;
+// that thread writes on a connection of its own, opened when it starts
+template <typename T> class SampleLogger : public QThread {
+public:
+    SampleLogger(const QString& spillPath,
+                 int batchRows = 200,
+                 int batchInterval = 1000,
+                 int capacity = 20000)
+        : spill_(spillPath),
+          quarantine_(spillPath + ".bad"),
+          batchRows_(batchRows),
+          batchInterval_(batchInterval),
+          capacity_(capacity) {}
+
+    ~SampleLogger() { stop(0); }
+
+    // never blocks; returns false and counts a drop once capacity samples are queued
+    bool log(const T& sample) {
+        if (size_.fetch_add(1, std::memory_order_relaxed) >= capacity_) {
+            size_.fetch_sub(1, std::memory_order_relaxed);
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        queue_.push(sample);
+        if (size_.load(std::memory_order_relaxed) == batchRows_) {
+            QMutexLocker l(&mutex_);
+            cond_.wakeOne();
+        }
+        return true;
+    }
+
+    // flushes what is queued within deadline ms, the rest goes to the spill file
+    void stop(int deadline) {
+        if (!isRunning()) return;
+        {
+            QMutexLocker l(&mutex_);
+            deadline_ = deadline;
+            stopping_ = true;
+            cond_.wakeOne();
+        }
+        wait();
+    }
+
+    int pending() const { return size_.load(std::memory_order_relaxed); }
+    int dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    qint64 written() const { return written_.load(std::memory_order_relaxed); }
+    qint64 spilled() const { return spilled_.load(std::memory_order_relaxed); }
+    // samples the database refused for good and spill records that could not be read, kept
+    // in <spillPath>.bad in the spill file's format
+    qint64 quarantined() const { return quarantined_.load(std::memory_order_relaxed); }
+
+protected:
+    void run() override {
+        const DatabaseHelper::ThreadDB db(DatabaseHelper::Role::Write);
+        QVector<T> batch;
+        batch.reserve(batchRows_);
+        QElapsedTimer shutdown;
+        while (true) {
+            bool stopping;
+            {
+                QMutexLocker l(&mutex_);
+                if (!stopping_ && size_.load(std::memory_order_relaxed) < batchRows_)
+                    cond_.wait(&mutex_, batchInterval_);
+                stopping = stopping_;
+            }
+            if (stopping && !shutdown.isValid()) shutdown.start();
+            const bool late = stopping && shutdown.elapsed() >= deadline_;
+
+            T t;
+            while (batch.size() < batchRows_ && queue_.pop(t)) {
+                size_.fetch_sub(1, std::memory_order_relaxed);
+                batch.push_back(t);
+            }
+            if (!batch.isEmpty()) commit(batch, late);
+            batch.clear();
+            if (stopping && size_.load(std::memory_order_relaxed) == 0) break;
+        }
+    }
+
+private:
+    // a failure that may pass on a retry spills the batch, rows the database refuses for good
+    // (a constraint, a changed schema) are quarantined so the rest of the batch still goes in
+    void commit(const QVector<T>& batch, bool spillOnly) {
+        if (spillOnly || !replay()) {
+            spill(batch);
+            return;
+        }
+        DatabaseHelper::persistentFailure = false;
+        int rows = QueryHelper::bulk(batch, QueryHelper::WriteMode::Insert);
+        if (rows < 0 && DatabaseHelper::persistentFailure) {
+            QVector<T> refused;
+            int next = 0;
+            auto row = [&batch, &next](T& t) {
+                if (next == batch.size()) return false;
+                t = batch.at(next++);
+                return true;
+            };
+            rows = insertEach(row, [&batch, &refused](int i) { refused.push_back(batch.at(i)); });
+            if (rows >= 0 && !quarantine(refused))
+                dropped_.fetch_add(refused.size(), std::memory_order_relaxed);
+        }
+        if (rows >= 0)
+            written_.fetch_add(rows, std::memory_order_relaxed);
+        else
+            spill(batch);
+    }
+
+    static inline void serialize(QDataStream& stream, const T& t) {
+        QVariantList row;
+        InjectionHelper::visit(t, [&row](auto&... args) {
+            std::initializer_list<int>{(SerializationHelper::serialize(args, row), 0)...};
+        });
+        stream << row;
+    }
+
+    void spill(const QVector<T>& batch) {
+        if (!spill_.isOpen() && !spill_.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            dropped_.fetch_add(batch.size(), std::memory_order_relaxed);
+            return;
+        }
+        QDataStream stream(&spill_);
+        stream.setVersion(QDataStream::Qt_5_9);
+        for (const auto& it : batch) serialize(stream, it);
+        // the samples only count as spilled once they are on the medium
+        if (!spill_.flush() || ::fdatasync(spill_.handle()) != 0) {
+            spill_.close();
+            dropped_.fetch_add(batch.size(), std::memory_order_relaxed);
+            return;
+        }
+        spilled_.fetch_add(batch.size(), std::memory_order_relaxed);
+    }
+
+    // inserts the rows of next(T&) one at a time in a single transaction, each in a savepoint
+    // of its own; refused(index) gets the rows that fail for good. Returns the rows written,
+    // or -1 with nothing written once a failure that may pass on a retry rolled it all back
+    template <typename Next, typename Refused> int insertEach(Next next, Refused refused) {
+        Transaction transaction;
+        if (!transaction.isActive()) return -1;
+        int written = 0;
+        T t;
+        for (int index = 0; next(t); ++index) {
+            DatabaseHelper::persistentFailure = false;
+            if (QueryHelper::bulk(QVector<T>{t}, QueryHelper::WriteMode::Insert) >= 0) {
+                ++written;
+            } else if (DatabaseHelper::persistentFailure) {
+                refused(index);
+            } else {
+                return -1;
+            }
+        }
+        return transaction.commit() ? written : -1;
+    }
+
+    // reads the next record of the open spill file into t; records of the wrong shape are
+    // skipped and an unreadable tail (e.g. torn by a power cut) ends the read, both go to bad.
+    // record is the byte range of the record read
+    bool read(QDataStream& stream,
+              T& t,
+              QVector<QPair<qint64, qint64>>& bad,
+              QPair<qint64, qint64>& record) {
+        while (!stream.atEnd()) {
+            const qint64 begin = spill_.pos();
+            QVariantList row;
+            stream >> row;
+            if (stream.status() != QDataStream::Ok) {
+                bad.push_back(qMakePair(begin, spill_.size()));
+                return false;
+            }
+            record = qMakePair(begin, spill_.pos());
+            if (row.size() != InjectionHelper::fieldCount<T>()) {
+                bad.push_back(record);
+                continue;
+            }
+            InjectionHelper::visit(t, [&row](auto&... args) {
+                int index = 0;
+                std::initializer_list<int>{
+                        (DeserializationHelper::deserialize(args, row.at(index++)), 0)...};
+            });
+            return true;
+        }
+        return false;
+    }
+
+    // pushes spilled rows back in one transaction, the file is kept if that fails with a
+    // failure that may pass on a retry. Otherwise the records go in one by one and those the
+    // database refuses join the unreadable ones in the quarantine file before the spill file
+    // is removed
+    bool replay() {
+        if (spill_.isOpen()) spill_.close();
+        if (!spill_.exists() || spill_.size() == 0) return true;
+        if (!spill_.open(QIODevice::ReadOnly)) return false;
+        QDataStream stream(&spill_);
+        stream.setVersion(QDataStream::Qt_5_9);
+        QVector<QPair<qint64, qint64>> bad;
+        QPair<qint64, qint64> record;
+        DatabaseHelper::persistentFailure = false;
+        int rows = QueryHelper::generate<T>(
+                [this, &stream, &bad, &record](T& t) { return read(stream, t, bad, record); },
+                QueryHelper::WriteMode::Insert);
+        if (rows < 0 && DatabaseHelper::persistentFailure && spill_.seek(0)) {
+            stream.resetStatus();
+            bad.clear();
+            QVector<QPair<qint64, qint64>> ranges;
+            rows = insertEach(
+                    [this, &stream, &bad, &record, &ranges](T& t) {
+                        if (!read(stream, t, bad, record)) return false;
+                        ranges.push_back(record);
+                        return true;
+                    },
+                    [&bad, &ranges](int index) { bad.push_back(ranges.at(index)); });
+            std::sort(bad.begin(), bad.end());
+        }
+        // once the rows are in, the spill file goes even if quarantining fails, replaying
+        // it again would insert them twice
+        if (rows >= 0) quarantine(bad);
+        spill_.close();
+        if (rows < 0) return false;
+        written_.fetch_add(rows, std::memory_order_relaxed);
+        spill_.remove();
+        return true;
+    }
+
+    // appends the given byte ranges of the open spill file to the quarantine file
+    bool quarantine(const QVector<QPair<qint64, qint64>>& ranges) {
+        if (ranges.isEmpty()) return true;
+        if (!quarantine_.open(QIODevice::WriteOnly | QIODevice::Append)) return false;
+        bool ok = true;
+        for (const auto& it : ranges)
+            ok = ok && spill_.seek(it.first) &&
+                 quarantine_.write(spill_.read(it.second - it.first)) == it.second - it.first;
+        ok = ok && quarantine_.flush() && ::fdatasync(quarantine_.handle()) == 0;
+        quarantine_.close();
+        if (ok) quarantined_.fetch_add(ranges.size(), std::memory_order_relaxed);
+        return ok;
+    }
+
+    // appends rows in the spill record format to the quarantine file
+    bool quarantine(const QVector<T>& rows) {
+        if (rows.isEmpty()) return true;
+        if (!quarantine_.open(QIODevice::WriteOnly | QIODevice::Append)) return false;
+        QDataStream stream(&quarantine_);
+        stream.setVersion(QDataStream::Qt_5_9);
+        for (const auto& it : rows) serialize(stream, it);
+        const bool ok = quarantine_.flush() && ::fdatasync(quarantine_.handle()) == 0;
+        quarantine_.close();
+        if (ok) quarantined_.fetch_add(rows.size(), std::memory_order_relaxed);
+        return ok;
+    }
+
+    MpscQueue<T> queue_;
+    std::atomic<int> size_{0};
+    std::atomic<int> dropped_{0};
+    std::atomic<qint64> written_{0};
+    std::atomic<qint64> spilled_{0};
+    std::atomic<qint64> quarantined_{0};
+
+    QFile spill_;
+    QFile quarantine_;
+    const int batchRows_;
+    const int batchInterval_;
+    const int capacity_;
+
+    QMutex mutex_;
+    QWaitCondition cond_;
+    bool stopping_{false};
+    int deadline_{0};
+};
+
+}  // namespace WORM
+
+#endif  // SAMPLELOGGER_HPP
@@ -0,0 +1,478 @@
+#ifndef TABLEEXPORT_HPP
+#define TABLEEXPORT_HPP
+
+#include <unistd.h>
+#include <zlib.h>
+#include <QFile>
+#include <QLocale>
+#include <QThread>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "worm.hpp"
+
+namespace WORM {
+
+struct ExportOptions {
+    enum Format { Csv, Columnar };
+    Format format = Csv;
+    // gzip stream around the output, level 1 keeps up with a USB stick on the board
+    bool compress = false;
+    int level = 1;
+    // serialised bytes per chunk handed to compression and the writer thread
+    int chunkBytes = 1 << 20;
+    // rows per block of the columnar format
+    int blockRows = 4096;
+    // rows per select, the pooled connection is given back between two of them
+    int pageRows = 10000;
+    // written bytes between two fdatasync calls
+    qint64 syncBytes = 16 << 20;
+};
+
+// per field type output of TableExport. The columnar format is little-endian: "WORMCOL1",
+// u32 field count, per field u8 type and u16 length plus utf-8 name, then blocks of u32 rows
+// and per field u32 length plus the column, ended by a block of 0 rows. Strings and bytes
+// are u32 length plus data, date times i64 ms since epoch
+struct ExportHelper {
+    enum Type : quint8 {
+        Int32 = 1,
+        UInt32,
+        Int64,
+        UInt64,
+        Float64,
+        Float32,
+        Bool,
+        String,
+        Bytes,
+        DateTime
+    };
+
+    static inline void csv(QByteArray& out, int v) { out += QByteArray::number(v); }
+    static inline void csv(QByteArray& out, uint v) { out += QByteArray::number(v); }
+    static inline void csv(QByteArray& out, qint64 v) { out += QByteArray::number(v); }
+    static inline void csv(QByteArray& out, quint64 v) { out += QByteArray::number(v); }
+    static inline void csv(QByteArray& out, bool v) { out += v ? '1' : '0'; }
+    static inline void csv(QByteArray& out, float v) { shortest(out, v); }
+    static inline void csv(QByteArray& out, double v) {
+        out += QByteArray::number(v, 'g', QLocale::FloatingPointShortest);
+    }
+    static inline void csv(QByteArray& out, const QString& v) { quote(out, v.toUtf8()); }
+    static inline void csv(QByteArray& out, const QByteArray& v) { out += v.toBase64(); }
+    static inline void csv(QByteArray& out, const QDateTime& v) {
+        out += v.toString(Qt::ISODateWithMs).toUtf8();
+    }
+    template <typename T> static inline void csv(QByteArray& out, const T& v) {
+        QVariantList value;
+        SerializationHelper::serialize(v, value);
+        quote(out, value.first().toString().toUtf8());
+    }
+
+    static inline Type type(const int&) { return Int32; }
+    static inline Type type(const uint&) { return UInt32; }
+    static inline Type type(const qint64&) { return Int64; }
+    static inline Type type(const quint64&) { return UInt64; }
+    static inline Type type(const double&) { return Float64; }
+    static inline Type type(const float&) { return Float32; }
+    static inline Type type(const bool&) { return Bool; }
+    static inline Type type(const QByteArray&) { return Bytes; }
+    static inline Type type(const QDateTime&) { return DateTime; }
+    template <typename T> static inline Type type(const T&) { return String; }
+
+    static inline void column(QByteArray& out, int v) { raw(out, v); }
+    static inline void column(QByteArray& out, uint v) { raw(out, v); }
+    static inline void column(QByteArray& out, qint64 v) { raw(out, v); }
+    static inline void column(QByteArray& out, quint64 v) { raw(out, v); }
+    static inline void column(QByteArray& out, double v) { raw(out, v); }
+    static inline void column(QByteArray& out, float v) { raw(out, v); }
+    static inline void column(QByteArray& out, bool v) { out += char(v); }
+    static inline void column(QByteArray& out, const QByteArray& v) {
+        raw(out, quint32(v.size()));
+        out += v;
+    }
+    static inline void column(QByteArray& out, const QDateTime& v) {
+        raw(out, v.toMSecsSinceEpoch());
+    }
+    static inline void column(QByteArray& out, const QString& v) { column(out, v.toUtf8()); }
+    template <typename T> static inline void column(QByteArray& out, const T& v) {
+        QVariantList value;
+        SerializationHelper::serialize(v, value);
+        column(out, value.first().toString());
+    }
+
+    template <typename T> static inline void raw(QByteArray& out, T v) {
+        static_assert(Q_BYTE_ORDER == Q_LITTLE_ENDIAN, "columnar export assumes little-endian");
+        out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+    }
+
+    // fewest digits that read back to the same float, Qt only has that for double
+    static inline void shortest(QByteArray& out, float v) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.7g", double(v));
+        if (std::strtof(text, nullptr) != v) std::snprintf(text, sizeof(text), "%.9g", double(v));
+        out += text;
+    }
+
+    static inline void quote(QByteArray& out, const QByteArray& v) {
+        if (v.indexOf(',') < 0 && v.indexOf('"') < 0 && v.indexOf('\n') < 0 &&
+            v.indexOf('\r') < 0) {
+            out += v;
+            return;
+        }
+        out += '"';
+        for (char ch : v) {
+            if (ch == '"') out += '"';
+            out += ch;
+        }
+        out += '"';
+    }
+};
+
+// writes chunks to a file on its own thread while the caller produces the next one, so at
+// most one chunk waits; syncs every syncBytes to keep little dirty data in the page cache
+class ChunkWriter : public QThread {
+public:
+    ChunkWriter(const QString& path, qint64 syncBytes) : file_(path), syncBytes_(syncBytes) {}
+
+    ~ChunkWriter() { finish(); }
+
+    bool open() {
+        if (!file_.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered))
+            return false;
+        start();
+        return true;
+    }
+
+    // blocks while the previous chunk is still queued, false once a write failed
+    bool write(const QByteArray& chunk) {
+        QMutexLocker l(&mutex_);
+        while (!queue_.isEmpty() && !failed_) cond_.wait(&mutex_);
+        if (failed_) return false;
+        queue_.enqueue(chunk);
+        cond_.wakeAll();
+        return true;
+    }
+
+    // writes what is queued, syncs and closes; false if any write failed
+    bool finish() {
+        if (isRunning()) {
+            {
+                QMutexLocker l(&mutex_);
+                finishing_ = true;
+                cond_.wakeAll();
+            }
+            wait();
+        }
+        return !failed_;
+    }
+
+    void remove() { file_.remove(); }
+
+    qint64 written() const { return written_.load(std::memory_order_relaxed); }
+
+protected:
+    void run() override {
+        qint64 synced = 0;
+        while (true) {
+            QByteArray chunk;
+            {
+                QMutexLocker l(&mutex_);
+                while (queue_.isEmpty() && !finishing_) cond_.wait(&mutex_);
+                if (queue_.isEmpty()) break;
+                chunk = queue_.dequeue();
+                cond_.wakeAll();
+            }
+            if (file_.write(chunk) != chunk.size()) {
+                QMutexLocker l(&mutex_);
+                failed_ = true;
+                queue_.clear();
+                cond_.wakeAll();
+                break;
+            }
+            const qint64 written =
+                    written_.fetch_add(chunk.size(), std::memory_order_relaxed) + chunk.size();
+            if (written - synced >= syncBytes_) {
+                ::fdatasync(file_.handle());
+                synced = written;
+            }
+        }
+        if (::fsync(file_.handle()) != 0) failed_ = true;
+        file_.close();
+    }
+
+private:
+    QFile file_;
+    const qint64 syncBytes_;
+    std::atomic<qint64> written_{0};
+
+    QMutex mutex_;
+    QWaitCondition cond_;
+    QQueue<QByteArray> queue_;
+    bool finishing_{false};
+    bool failed_{false};
+};
+
+// exports the rows of T matching condition to a file on its own thread and connection,
+// reading them forward only in pages and holding a few chunks at a time; a cancelled or failed
+// export removes the file. Pages follow the ORKEY fields, entities without a key page by
+// offset in the order of all their fields, which rescans the skipped rows for every page
+template <typename T> class TableExport : public QThread {
+public:
+    enum class Status { Idle, Running, Done, Cancelled, Failed };
+
+    TableExport(const QString& path,
+                const QString& condition = "",
+                const QVariantList& bindings = {},
+                const ExportOptions& options = ExportOptions())
+        : path_(path), condition_(condition), bindings_(bindings), options_(options) {}
+
+    ~TableExport() {
+        cancel();
+        wait();
+    }
+
+    // called on the export thread after every chunk, total is -1 if it could not be counted
+    std::function<void(qint64 rows, qint64 total)> progress;
+
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+
+    Status status() const { return Status(status_.load(std::memory_order_acquire)); }
+    qint64 rows() const { return rows_.load(std::memory_order_relaxed); }
+    qint64 total() const { return total_.load(std::memory_order_relaxed); }
+    // bytes on the stick so far
+    qint64 written() const { return written_.load(std::memory_order_relaxed); }
+
+protected:
+    void run() override {
+        const DatabaseHelper::ThreadDB db(DatabaseHelper::Role::Read);
+        status_.store(int(Status::Running), std::memory_order_release);
+        total_.store(count(), std::memory_order_relaxed);
+        ChunkWriter writer(path_, options_.syncBytes);
+        writer_ = &writer;
+        bool ok = writer.open() && begin() && header();
+        const int fieldCount = InjectionHelper::fieldCount<T>();
+        QVector<QByteArray> columns(fieldCount);
+        int blockRows = 0, blockBytes = 0;
+        auto block = [&]() {
+            ExportHelper::raw(buffer_, quint32(blockRows));
+            for (auto& it : columns) {
+                ExportHelper::raw(buffer_, quint32(it.size()));
+                buffer_ += it;
+                it.clear();
+            }
+            blockRows = blockBytes = 0;
+        };
+        if (ok) {
+            QByteArray& buffer = buffer_;
+            const auto& keys = InjectionHelper::keyIndexes<T>();
+            const Page page = this->page();
+            QVariantList last;
+            qint64 rows = 0;
+            while (ok) {
+                // one select per page, so a client-side buffering driver holds a page at most
+                QVariantList bindings = bindings_;
+                if (!last.isEmpty()) bindings += last;
+                bindings << options_.pageRows;
+                if (keys.isEmpty()) bindings << rows;
+                int pageRows = 0;
+                bool stopped = false;
+                const int visited = QueryHelper::forEach<T>(
+                        last.isEmpty() ? page.first : page.next,
+                        [&](const T& t) {
+                            if (options_.format == ExportOptions::Csv) {
+                                InjectionHelper::visit(t, [&buffer](auto&... args) {
+                                    std::initializer_list<int>{
+                                            (ExportHelper::csv(buffer, args), buffer += ',',
+                                             0)...};
+                                });
+                                buffer[buffer.size() - 1] = '\n';
+                            } else {
+                                const int before = columnBytes(columns);
+                                InjectionHelper::visit(t, [&columns](auto&... args) {
+                                    int index = 0;
+                                    std::initializer_list<int>{
+                                            (ExportHelper::column(columns[index++], args),
+                                             0)...};
+                                });
+                                blockBytes += columnBytes(columns) - before;
+                                if (++blockRows == options_.blockRows ||
+                                    blockBytes >= options_.chunkBytes)
+                                    block();
+                            }
+                            rows_.store(++rows, std::memory_order_relaxed);
+                            // the next page starts after the key of a full page's last row
+                            if (++pageRows == options_.pageRows && !keys.isEmpty())
+                                last = key(t);
+                            if (buffer_.size() >= options_.chunkBytes) ok = ok && flush(false);
+                            stopped = !ok || cancelled_.load(std::memory_order_relaxed);
+                            return !stopped;
+                        },
+                        bindings);
+                if (visited < 0) ok = false;
+                if (visited < options_.pageRows || stopped) break;
+            }
+            if (options_.format == ExportOptions::Columnar) {
+                if (blockRows > 0) block();
+                block();  // end marker
+            }
+        }
+        ok = ok && flush(true);
+        end();
+        ok = writer.finish() && ok;
+        written_.store(writer.written(), std::memory_order_relaxed);
+        const bool cancelled = cancelled_.load(std::memory_order_relaxed);
+        if (!ok || cancelled) writer.remove();
+        writer_ = nullptr;
+        status_.store(int(cancelled ? Status::Cancelled : ok ? Status::Done : Status::Failed),
+                      std::memory_order_release);
+    }
+
+private:
+    // conditions of the first and of every later page, bound to bindings_, the key of the
+    // previous page's last row (keyset) and then the limit, or the limit and the offset
+    struct Page {
+        QString first;
+        QString next;
+    };
+
+    Page page() const {
+        const auto& keys = InjectionHelper::keyIndexes<T>();
+        const QString where =
+                condition_.trimmed().isEmpty() ? QString("1 = 1") : "(" + condition_ + ")";
+        if (keys.isEmpty()) {
+            const QString first = where + QString(" order by %1 limit ? offset ?")
+                                                  .arg(InjectionHelper::fields<T>());
+            return {first, first};
+        }
+        QStringList marks;
+        for (int i = 0; i < keys.size(); ++i) marks << "?";
+        const QString& names = InjectionHelper::keys<T>();
+        const QString order = QString(" order by %1 limit ?").arg(names);
+        const QString after = QString(" and (%1) > (%2)").arg(names).arg(marks.join(','));
+        return {where + order, where + after + order};
+    }
+
+    static inline QVariantList key(const T& t) {
+        QVariantList values, ret;
+        InjectionHelper::visit(t, [&values](auto&... args) {
+            std::initializer_list<int>{(SerializationHelper::serialize(args, values), 0)...};
+        });
+        for (int it : InjectionHelper::keyIndexes<T>()) ret << values.at(it);
+        return ret;
+    }
+
+    static inline int columnBytes(const QVector<QByteArray>& columns) {
+        int ret = 0;
+        for (const auto& it : columns) ret += it.size();
+        return ret;
+    }
+
+    qint64 count() {
+        auto db = DatabaseHelper::getDB(DatabaseHelper::Role::Read);
+        if (!db) return -1;
+        auto autoRelease = DatabaseHelper::reset(db);
+        auto query = DatabaseHelper::prepare(
+                db,
+                QString("select count(*) from %1 %2;")
+                        .arg(InjectionHelper::tableName<T>())
+                        .arg(condition_.trimmed().isEmpty() ? "" : "where " + condition_));
+        DatabaseHelper::bind(query, bindings_);
+        DatabaseHelper::exec(db, query, InjectionHelper::tableName<T>(), "select");
+        const qint64 ret = query.next() ? query.value(0).toLongLong() : -1;
+        query.finish();
+        return ret;
+    }
+
+    bool header() {
+        const QStringList& names = InjectionHelper::fieldNames<T>();
+        if (options_.format == ExportOptions::Csv) {
+            buffer_.clear();
+            for (const auto& it : names) {
+                ExportHelper::quote(buffer_, it.toUtf8());
+                buffer_ += ',';
+            }
+            buffer_[buffer_.size() - 1] = '\n';
+            return true;
+        }
+        buffer_ = "WORMCOL1";
+        ExportHelper::raw(buffer_, quint32(names.size()));
+        T t;
+        QVector<ExportHelper::Type> types;
+        InjectionHelper::visit(t, [&types](auto&... args) {
+            std::initializer_list<int>{(types.push_back(ExportHelper::type(args)), 0)...};
+        });
+        for (int i = 0; i < names.size(); ++i) {
+            const QByteArray name = names.at(i).toUtf8();
+            buffer_ += char(types.at(i));
+            ExportHelper::raw(buffer_, quint16(name.size()));
+            buffer_ += name;
+        }
+        return true;
+    }
+
+    bool begin() {
+        if (!options_.compress) return true;
+        std::memset(&stream_, 0, sizeof(stream_));
+        // 16 + window bits asks for a gzip wrapper
+        deflating_ = deflateInit2(&stream_, options_.level, Z_DEFLATED, 16 + MAX_WBITS, 8,
+                                  Z_DEFAULT_STRATEGY) == Z_OK;
+        return deflating_;
+    }
+
+    void end() {
+        if (deflating_) deflateEnd(&stream_);
+        deflating_ = false;
+    }
+
+    // hands the buffered bytes, compressed if asked, to the writer thread
+    bool flush(bool last) {
+        if (!deflating_) {
+            bool ok = buffer_.isEmpty() || writer_->write(buffer_);
+            buffer_.clear();
+            report();
+            return ok;
+        }
+        stream_.next_in = reinterpret_cast<Bytef*>(buffer_.data());
+        stream_.avail_in = uInt(buffer_.size());
+        QByteArray out;
+        int ret;
+        do {
+            const int used = out.size();
+            out.resize(used + qMax(int(deflateBound(&stream_, stream_.avail_in)), 1 << 16));
+            stream_.next_out = reinterpret_cast<Bytef*>(out.data() + used);
+            stream_.avail_out = uInt(out.size() - used);
+            ret = deflate(&stream_, last ? Z_FINISH : Z_NO_FLUSH);
+            out.resize(out.size() - int(stream_.avail_out));
+        } while (ret == Z_OK && (last || stream_.avail_in > 0));
+        buffer_.clear();
+        report();
+        if (ret != Z_OK && ret != Z_BUF_ERROR && ret != Z_STREAM_END) return false;
+        return out.isEmpty() || writer_->write(out);
+    }
+
+    void report() {
+        written_.store(writer_->written(), std::memory_order_relaxed);
+        if (progress) progress(rows_.load(std::memory_order_relaxed), total());
+    }
+
+    const QString path_;
+    const QString condition_;
+    const QVariantList bindings_;
+    const ExportOptions options_;
+
+    QByteArray buffer_;
+    z_stream stream_;
+    bool deflating_{false};
+    ChunkWriter* writer_{nullptr};
+
+    std::atomic<int> status_{int(Status::Idle)};
+    std::atomic<bool> cancelled_{false};
+    std::atomic<qint64> rows_{0};
+    std::atomic<qint64> total_{-1};
+    std::atomic<qint64> written_{0};
+};
+
+}  // namespace WORM
+
+#endif  // TABLEEXPORT_HPP
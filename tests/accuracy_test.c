@@ -0,0 +1,125 @@
+/* psych_set_accuracy: the batched forms follow the selected mode like the scalar functions,
+    psych_accuracy_error leaves the mode alone and switching it while other threads evaluate
+    never mixes tables; prints every failed check and exits non-zero if there was one.
+
+        gcc -std=c99 -O2 -pthread -I.. accuracy_test.c ../psychropy.c -lm -o accuracy_test
+        ./accuracy_test
+*/
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include "psychropy.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                         \
+    do {                                                         \
+        if (!(cond)) {                                           \
+            printf("%s:%d: %s: ", __FILE__, __LINE__, #cond);    \
+            printf(__VA_ARGS__);                                 \
+            printf("\n");                                        \
+            ++failures;                                          \
+        }                                                        \
+    } while (0)
+
+enum { N = 301 };
+
+// exact in a table mode, where the batched forms run the scalar loop, and within the
+// PSYCHROPY_N_ULP carried through the formulas for the reference vector kernels
+static void compare(const char* name, psych_accuracy mode, const double* ref,
+                    const double* out) {
+    int i;
+    for (i = 0; i < N; ++i) {
+        if (mode == PSYCH_ACCURACY_REFERENCE) {
+            CHECK(fabs(out[i] - ref[i]) <= 1e-12 * fabs(ref[i]) + 1e-13, "%s mode %d %d: %.17g "
+                  "vs %.17g", name, mode, i, out[i], ref[i]);
+        } else {
+            CHECK(out[i] == ref[i], "%s mode %d %d: %.17g vs %.17g", name, mode, i, out[i],
+                  ref[i]);
+        }
+    }
+}
+
+static void batched(void) {
+    double Tdb[N], Twb[N], RH[N], P[N], W[N], ref[N], out[N];
+    int mode, i;
+    for (i = 0; i < N; ++i) {
+        Tdb[i] = -50 + 0.5 * i;
+        RH[i] = 0.05 + 0.9 * (i % 19) / 18.0;
+        P[i] = Sat_press(Tdb[i]) < 50 ? 101.325 : 2 * Sat_press(Tdb[i]) + 10;
+        W[i] = Hum_rat2(Tdb[i], RH[i], P[i]);
+        Twb[i] = Wet_bulb(Tdb[i], RH[i], P[i]);
+    }
+    for (mode = PSYCH_ACCURACY_REFERENCE; mode <= PSYCH_ACCURACY_FAST; ++mode) {
+        psych_set_accuracy((psych_accuracy)mode);
+        for (i = 0; i < N; ++i) ref[i] = Sat_press(Tdb[i]);
+        Sat_press_n(Tdb, out, N);
+        compare("Sat_press", mode, ref, out);
+        for (i = 0; i < N; ++i) ref[i] = Hum_rat(Tdb[i], Twb[i], P[i]);
+        Hum_rat_n(Tdb, Twb, P, out, N);
+        compare("Hum_rat", mode, ref, out);
+        for (i = 0; i < N; ++i) ref[i] = Hum_rat2(Tdb[i], RH[i], P[i]);
+        Hum_rat2_n(Tdb, RH, P, out, N);
+        compare("Hum_rat2", mode, ref, out);
+        for (i = 0; i < N; ++i) ref[i] = Rel_hum(Tdb[i], Twb[i], P[i]);
+        Rel_hum_n(Tdb, Twb, P, out, N);
+        compare("Rel_hum", mode, ref, out);
+        for (i = 0; i < N; ++i) ref[i] = Rel_hum2(Tdb[i], W[i], P[i]);
+        Rel_hum2_n(Tdb, W, P, out, N);
+        compare("Rel_hum2", mode, ref, out);
+        for (i = 0; i < N; ++i) ref[i] = Dew_point(P[i], W[i]);
+        Dew_point_n(P, W, out, N);
+        compare("Dew_point", mode, ref, out);
+    }
+    psych_set_accuracy(PSYCH_ACCURACY_REFERENCE);
+}
+
+static void error_report(void) {
+    double sat = 0, dew = 0;
+    psych_set_accuracy(PSYCH_ACCURACY_HIGH);
+    psych_accuracy_error(PSYCH_ACCURACY_FAST, &sat, &dew);
+    CHECK(psych_get_accuracy() == PSYCH_ACCURACY_HIGH, "mode %d", psych_get_accuracy());
+    CHECK(sat > 0 && sat < 2e-7 && dew > 0 && dew < 1e-6, "FAST %g %g", sat, dew);
+    psych_accuracy_error(PSYCH_ACCURACY_HIGH, &sat, &dew);
+    CHECK(sat < 1e-12 && dew < 1e-10, "HIGH %g %g", sat, dew);
+    psych_set_accuracy(PSYCH_ACCURACY_REFERENCE);
+}
+
+static volatile int stop = 0;
+
+// every result must be one of the three modes' values, within the FAST bound of the formula
+static void* evaluate(void* arg) {
+    const double sat = Sat_press(25.3), dew = Dew_point(101.325, 0.0123);
+    long bad = 0;
+    while (!stop) {
+        if (!(fabs(Sat_press(25.3) - sat) <= 2e-7 * sat)) ++bad;
+        if (!(fabs(Dew_point(101.325, 0.0123) - dew) <= 1e-6)) ++bad;
+    }
+    *(long*)arg = bad;
+    return NULL;
+}
+
+static void concurrent(void) {
+    pthread_t threads[4];
+    long bad[4];
+    int i;
+    psych_set_accuracy(PSYCH_ACCURACY_REFERENCE);
+    for (i = 0; i < 4; ++i) pthread_create(&threads[i], NULL, evaluate, &bad[i]);
+    // the first switches build the tables while the threads are already reading the mode
+    for (i = 0; i < 30000; ++i) psych_set_accuracy((psych_accuracy)(i % 3));
+    stop = 1;
+    for (i = 0; i < 4; ++i) {
+        pthread_join(threads[i], NULL);
+        CHECK(bad[i] == 0, "thread %d: %ld results off", i, bad[i]);
+    }
+    psych_set_accuracy(PSYCH_ACCURACY_REFERENCE);
+}
+
+int main(void) {
+    // before batched() builds the tables on this thread
+    concurrent();
+    batched();
+    error_report();
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures != 0;
+}
@@ -0,0 +1,208 @@
+// DensityModel against scipy_cell.py: curve_fit results for all six models on a fixed dataset,
+// recursive updates against a refit and save()/load(); prints every failed check and exits
+// non-zero if there was one
+//
+//   g++ -std=c++14 -O2 -fPIC -I.. densitymodel_test.cpp -o densitymodel_test
+//       $(pkg-config --cflags --libs Qt5Core)
+//   ./densitymodel_test
+
+#include <QFile>
+#include <cmath>
+#include <cstdio>
+
+#include "densitymodel.hpp"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                            \
+    do {                                                            \
+        if (!(cond)) {                                              \
+            std::printf("%s:%d: %s: ", __FILE__, __LINE__, #cond);  \
+            std::printf(__VA_ARGS__);                               \
+            std::printf("\n");                                      \
+            ++failures;                                             \
+        }                                                           \
+    } while (0)
+
+// x1 (temperature), x2 (concentration) and the measured density y
+static const double samples[][3] = {
+    {20.0, 0.1, 1.2269},
+    {20.5, 0.24, 1.279323165},
+    {21.0, 0.38, 1.331480459},
+    {21.5, 0.52, 1.386187685},
+    {22.0, 0.16, 1.248358113},
+    {22.5, 0.3, 1.300960987},
+    {23.0, 0.44, 1.353734125},
+    {23.5, 0.58, 1.410060363},
+    {24.0, 0.22, 1.270055162},
+    {24.5, 0.36, 1.322758241},
+    {25.0, 0.5, 1.376538603},
+    {25.5, 0.14, 1.238687501},
+    {26.0, 0.28, 1.291895793},
+    {26.5, 0.42, 1.344819863},
+    {27.0, 0.56, 1.399962202},
+    {27.5, 0.2, 1.260396558},
+    {28.0, 0.34, 1.313843273},
+    {28.5, 0.48, 1.367277863},
+    {29.0, 0.12, 1.229057639},
+    {29.5, 0.26, 1.282379828},
+    {30.0, 0.4, 1.335929083},
+    {30.5, 0.54, 1.390256833},
+    {31.0, 0.18, 1.250561328},
+    {31.5, 0.32, 1.3045291},
+    {32.0, 0.46, 1.358244693},
+    {32.5, 0.1, 1.219716413},
+    {33.0, 0.24, 1.272509987},
+    {33.5, 0.38, 1.326788929},
+    {34.0, 0.52, 1.380917675},
+    {34.5, 0.16, 1.240829176},
+    {35.0, 0.3, 1.294770229},
+    {35.5, 0.44, 1.349171113},
+    {36.0, 0.58, 1.404078373},
+    {36.5, 0.22, 1.262524734},
+    {37.0, 0.36, 1.317223404},
+    {37.5, 0.5, 1.371751615},
+    {38.0, 0.14, 1.231425863},
+    {38.5, 0.28, 1.284701594},
+    {39.0, 0.42, 1.339796589},
+    {39.5, 0.56, 1.394650719},
+};
+static const int count = sizeof(samples) / sizeof(samples[0]);
+
+// the points density() is checked at
+static const double queries[4][2] = {{21.3, 0.17}, {28.0, 0.33}, {35.75, 0.52}, {39.5, 0.58}};
+
+// popt and density(queries) after formula(i, x1, x2, y) of scipy_cell.py on all samples,
+// SciPy 1.17 curve_fit with its default tolerances
+static const struct {
+    double popt[6];
+    double density[4];
+} scipy[6] = {
+        {{0.0005930610283302329, 1.2964828062321814},
+         {1.3091150061356154, 1.313088515025428, 1.3176847379949872, 1.3199087168512256}},
+        {{0.384108184270978, 1.18256931871219},
+         {1.2478677100382563, 1.3093250195216126, 1.3823055745330985, 1.4053520655893572}},
+        {{-0.0014517916964260635, 3.43672726849098e-05, 1.3257551307414543},
+         {1.310424055551996, 1.3120489050264939, 1.3177771000400802, 1.3220308959392553}},
+        {{0.3655413121949377, 0.027157542446077685, 1.185157647628154},
+         {1.248084523677985, 1.3087437370248614, 1.382582529446941, 1.4063074059800784}},
+        {{-0.00048659213517865217, 0.38621152717710244, 1.1963250397885732},
+         {1.2516165869293754, 1.3101502639720148, 1.3797593650880295, 1.4011073362117359}},
+        {{-0.0005167734456625101, 0.35718423062796845, -2.2441983277282307e-06,
+          0.021712642155779536, 0.0004786933877594827, 1.201288833362817},
+         {1.2523455519530324, 1.3097181551362196, 1.3804517653990653, 1.4028126239173058}}};
+
+static const int terms[6] = {2, 2, 3, 3, 3, 6};
+
+// curve_fit stops once its Levenberg-Marquardt step is below xtol, not at the exact least
+// squares solution the QR fit finds: coefficients differ by up to 3e-5 relative (func6), the
+// fitted densities by 2e-9
+static const double coeffTolerance = 1e-4;
+static const double densityTolerance = 1e-8;
+
+static void columns(int n, QVector<double>& x1, QVector<double>& x2, QVector<double>& y) {
+    for (int k = 0; k < n; ++k) {
+        x1.append(samples[k][0]);
+        x2.append(samples[k][1]);
+        y.append(samples[k][2]);
+    }
+}
+
+static void checkDensities(const DensityModel& model, int i, const char* what) {
+    for (int q = 0; q < 4; ++q) {
+        const double d = model.density(queries[q][0], queries[q][1]);
+        CHECK(std::fabs(d - scipy[i].density[q]) <= densityTolerance,
+              "%s func%d at (%g, %g): %.17g vs %.17g", what, i + 1, queries[q][0],
+              queries[q][1], d, scipy[i].density[q]);
+    }
+}
+
+static void fit() {
+    QVector<double> x1, x2, y;
+    columns(count, x1, x2, y);
+    for (int i = 0; i < 6; ++i) {
+        DensityModel model;
+        CHECK(model.formula(i, x1, x2, y), "func%d", i + 1);
+        CHECK(model.model() == i, "func%d: model %d", i + 1, model.model());
+        const QVector<double> coeff = model.coefficients();
+        CHECK(coeff.size() == terms[i], "func%d: %d coefficients", i + 1, coeff.size());
+        for (int k = 0; k < coeff.size() && k < terms[i]; ++k) {
+            const double ref = scipy[i].popt[k];
+            CHECK(std::fabs(coeff.at(k) - ref) <= coeffTolerance * std::fabs(ref),
+                  "func%d popt[%d]: %.17g vs %.17g", i + 1, k, coeff.at(k), ref);
+        }
+        checkDensities(model, i, "fit");
+    }
+}
+
+// with lambda 1, updating a fit on the first samples with the rest ends on the fit of all
+static void update() {
+    const int first = 30;
+    for (int i = 0; i < 6; ++i) {
+        QVector<double> x1, x2, y;
+        columns(first, x1, x2, y);
+        DensityModel model;
+        CHECK(model.formula(i, x1, x2, y), "func%d", i + 1);
+        for (int k = first; k < count; ++k) {
+            CHECK(model.update(samples[k][0], samples[k][1], samples[k][2]), "func%d", i + 1);
+        }
+        checkDensities(model, i, "update");
+    }
+}
+
+static void invalid() {
+    QVector<double> x1, x2, y;
+    columns(count, x1, x2, y);
+    DensityModel model;
+    CHECK(std::isnan(model.density(25, 0.3)) && model.model() == -1, "before the first fit");
+    CHECK(!model.formula(6, x1, x2, y) && !model.formula(-1, x1, x2, y), "unknown model");
+    CHECK(model.formula(2, x1, x2, y), "func3");
+    // a constant x1 leaves func3 undetermined, the previous fit stays
+    const QVector<double> constant(count, 25.0);
+    CHECK(!model.formula(2, constant, x2, y), "rank deficient");
+    CHECK(!model.formula(5, x1.mid(0, 5), x2.mid(0, 5), y.mid(0, 5)), "too few samples");
+    CHECK(model.model() == 2, "model %d", model.model());
+    checkDensities(model, 2, "kept");
+    // a forgetting factor outside (0, 1] would blow up or flip the covariance on update()
+    CHECK(model.setForgetting(0.95) && model.forgetting() == 0.95, "lambda 0.95");
+    for (double lambda : {0.0, -0.5, 1.5, std::nan(""), HUGE_VAL}) {
+        CHECK(!model.setForgetting(lambda), "lambda %g accepted", lambda);
+    }
+    CHECK(model.forgetting() == 0.95, "lambda %g after refusals", model.forgetting());
+    CHECK(model.setForgetting(1) && model.forgetting() == 1, "lambda 1");
+}
+
+// save() and load() keep the model, coefficients, covariance and lambda: both copies then
+// follow the same updates
+static void persist() {
+    const QString path("densitymodel_test.json");
+    QVector<double> x1, x2, y;
+    columns(20, x1, x2, y);
+    DensityModel model, loaded;
+    CHECK(model.formula(5, x1, x2, y), "func6");
+    model.setForgetting(0.98);
+    CHECK(model.save(path), "save");
+    CHECK(loaded.load(path), "load");
+    CHECK(loaded.model() == 5 && loaded.forgetting() == 0.98, "model %d lambda %g",
+          loaded.model(), loaded.forgetting());
+    CHECK(loaded.coefficients() == model.coefficients(), "coefficients");
+    for (int k = 20; k < count; ++k) {
+        model.update(samples[k][0], samples[k][1], samples[k][2]);
+        loaded.update(samples[k][0], samples[k][1], samples[k][2]);
+    }
+    for (int q = 0; q < 4; ++q) {
+        const double a = model.density(queries[q][0], queries[q][1]);
+        const double b = loaded.density(queries[q][0], queries[q][1]);
+        CHECK(std::fabs(a - b) <= 1e-12 * std::fabs(a), "%d: %.17g vs %.17g", q, a, b);
+    }
+    QFile::remove(path);
+}
+
+int main() {
+    fit();
+    update();
+    invalid();
+    persist();
+    std::printf("%s\n", failures ? "FAILED" : "OK");
+    return failures != 0;
+}
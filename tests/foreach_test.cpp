@@ -0,0 +1,105 @@
+// QueryHelper::forEach with queries nested in its callback: with only the sqlite() writer they
+// reuse the scan's connection instead of waiting for it, once there is a reader pool the
+// nested writes take the writer; prints every failed check and exits non-zero if there was one
+//
+//   g++ -std=c++14 -O2 -fPIC -I.. foreach_test.cpp -o foreach_test
+//       $(pkg-config --cflags --libs Qt5Core Qt5Sql)
+//   ./foreach_test
+
+#include <QCoreApplication>
+#include <QFile>
+#include <cstdio>
+
+#include "worm.hpp"
+
+class Item {
+public:
+    int id{0};
+    int value{0};
+    ORMAP("item", id, value)
+};
+
+using namespace WORM;
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                            \
+    do {                                                            \
+        if (!(cond)) {                                              \
+            std::printf("%s:%d: %s: ", __FILE__, __LINE__, #cond);  \
+            std::printf(__VA_ARGS__);                               \
+            std::printf("\n");                                      \
+            ++failures;                                             \
+        }                                                           \
+    } while (0)
+
+static void fill(int count) {
+    QueryHelper::remove<Item>();
+    QVector<Item> items(count);
+    for (int i = 0; i < count; ++i) items[i].id = i;
+    CHECK(QueryHelper::insert(items) == count, "insert %d items", count);
+}
+
+// a select, an update and a Transaction inside the callback, then the connection is back in
+// the pool for the next caller
+static void nested(const char* what) {
+    fill(10);
+    int selected = 0;
+    const int visited = QueryHelper::forEach<Item>("1 = 1 order by id", [&](const Item& item) {
+        QVector<Item> same;
+        QueryHelper::select(same, "id = ?", {item.id});
+        selected += same.size();
+        Item changed = item;
+        changed.value = item.id * 2;
+        CHECK(QueryHelper::update(changed, "id = ?", {item.id}), "%s: update %d", what,
+              item.id);
+        return true;
+    });
+    CHECK(visited == 10, "%s: %d rows visited", what, visited);
+    CHECK(selected == 10, "%s: %d rows selected inside the callback", what, selected);
+
+    int inTransaction = 0;
+    QueryHelper::forEach<Item>("id < 3", [&](const Item& item) {
+        Transaction transaction;
+        Item changed = item;
+        changed.value = -1;
+        inTransaction += QueryHelper::update(changed, "id = ?", {item.id}) && transaction.commit();
+        return true;
+    });
+    CHECK(inTransaction == 3, "%s: %d transactions committed", what, inTransaction);
+
+    QVector<Item> items;
+    QueryHelper::select(items, "1 = 1 order by id");
+    CHECK(items.size() == 10, "%s: %d rows after the scans", what, items.size());
+    for (const auto& it : items) {
+        const int expected = it.id < 3 ? -1 : it.id * 2;
+        CHECK(it.value == expected, "%s: item %d holds %d, %d expected", what, it.id, it.value,
+              expected);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    // a nested call waiting for the scan's connection fails the check instead of hanging
+    DatabaseHelper::acquireTimeout = 2000;
+
+    const QString path("foreach_test.db");
+    QFile::remove(path);
+    SqliteOptions options;
+    options.readers = 0;
+    CHECK(ConnectionHelper::sqlite(path, options), "sqlite");
+    CHECK(QueryHelper::execute("create table item (id integer primary key, value integer);"),
+          "create");
+    nested("one connection");
+
+    // the second call keeps the writer and adds the readers
+    options.readers = options.maxReaders = 1;
+    CHECK(ConnectionHelper::sqlite(path, options), "sqlite with a reader");
+    nested("reader pool");
+    QFile::remove(path);
+    QFile::remove(path + "-wal");
+    QFile::remove(path + "-shm");
+
+    std::printf("%s\n", failures ? "FAILED" : "OK");
+    return failures != 0;
+}
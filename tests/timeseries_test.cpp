@@ -0,0 +1,173 @@
+// TimeSeries recovery: crashes after the ring has wrapped, simulated by copying the mapped
+// file while appends after the last commit() are still in it; prints every failed check and
+// exits non-zero if there was one
+//
+//   g++ -std=c++14 -O2 -fPIC -I.. timeseries_test.cpp -o timeseries_test
+//       $(pkg-config --cflags --libs Qt5Core Qt5Sql)
+//   ./timeseries_test
+
+#include <QFile>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+#include "timeseries.hpp"
+
+using namespace WORM;
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                            \
+    do {                                                            \
+        if (!(cond)) {                                              \
+            std::printf("%s:%d: %s: ", __FILE__, __LINE__, #cond);  \
+            std::printf(__VA_ARGS__);                               \
+            std::printf("\n");                                      \
+            ++failures;                                             \
+        }                                                           \
+    } while (0)
+
+static const qint64 all[2] = {std::numeric_limits<qint64>::min() / 2,
+                              std::numeric_limits<qint64>::max() / 2};
+
+// 64 raw samples, then 16 buckets of 10, 100 and 1000 ms
+static TimeSeriesOptions options() {
+    TimeSeriesOptions ret;
+    ret.capacity[0] = 64;
+    for (int i = 1; i < TimeSeries::Levels; ++i) ret.capacity[i] = 16;
+    ret.period[0] = 10;
+    ret.period[1] = 100;
+    ret.period[2] = 1000;
+    return ret;
+}
+
+// the crash image: the slots and commit records exactly as the mapping left them
+static void crash(const QString& from, const QString& to) {
+    QFile::remove(to);
+    CHECK(QFile::copy(from, to), "copy %s", qPrintable(from));
+}
+
+// every level in time order, the raw samples equal to expected, and range queries agreeing
+// with a scan of expected
+static void check(const TimeSeries& series, const std::vector<qint64>& expected,
+                  const char* what) {
+    const auto samples = series.samples(all[0], all[1]);
+    CHECK(samples.count() == qint64(expected.size()), "%s: %lld samples, %zu expected", what,
+          samples.count(), expected.size());
+    for (qint64 i = 0; i < samples.count() && i < qint64(expected.size()); ++i) {
+        CHECK(samples.at(i).time == expected[i], "%s: sample %lld at %lld, %lld expected", what,
+              i, samples.at(i).time, expected[i]);
+    }
+    for (int tier = 1; tier < TimeSeries::Levels; ++tier) {
+        const auto buckets = series.buckets(tier, all[0], all[1]);
+        for (qint64 i = 1; i < buckets.count(); ++i) {
+            CHECK(buckets.at(i - 1).time < buckets.at(i).time, "%s: tier %d bucket %lld at "
+                  "%lld after %lld", what, tier, i, buckets.at(i).time, buckets.at(i - 1).time);
+        }
+    }
+    for (qint64 from = 400; from < 560; from += 7) {
+        const qint64 to = from + 15;
+        qint64 count = 0;
+        for (qint64 it : expected) count += it >= from && it <= to;
+        const auto range = series.samples(from, to);
+        CHECK(range.count() == count, "%s: [%lld, %lld] holds %lld samples, %lld expected", what,
+              from, to, range.count(), count);
+    }
+}
+
+static std::vector<qint64> span(qint64 first, qint64 last) {
+    std::vector<qint64> ret;
+    for (qint64 t = first; t <= last; ++t) ret.push_back(t);
+    return ret;
+}
+
+// closing commits, nothing committed is skipped on the next open
+static void clean() {
+    const QString path("timeseries_test_clean.ring");
+    QFile::remove(path);
+    {
+        TimeSeries series("clean", path, options());
+        CHECK(series.open(), "open");
+        for (qint64 t = 0; t < 500; ++t) series.append(t, t);
+    }
+    TimeSeries series("clean", path, options());
+    CHECK(series.open(), "reopen");
+    check(series, span(436, 499), "clean");
+    QFile::remove(path);
+}
+
+static void wrapped() {
+    const QString path("timeseries_test.ring"), first("timeseries_test_crash1.ring"),
+            second("timeseries_test_crash2.ring");
+    QFile::remove(path);
+    {
+        TimeSeries series("crash", path, options());
+        CHECK(series.open(), "open");
+        for (qint64 t = 0; t < 500; ++t) series.append(t, t);
+        CHECK(series.commit(), "commit");
+        // positions 500..519 reuse the slots of the committed 436..455
+        for (qint64 t = 500; t < 520; ++t) series.append(t, t);
+        crash(path, first);
+    }
+    {
+        TimeSeries series("crash", first, options());
+        CHECK(series.open(), "open after the first crash");
+        check(series, span(456, 499), "first crash");
+        // a sample older than the committed ones is still rejected
+        CHECK(!series.append(498, 0), "older sample");
+        // reuses the slots of 436..445, 446..455 still hold the lost 510..519
+        for (qint64 t = 520; t < 530; ++t) series.append(t, t);
+        std::vector<qint64> expected = span(456, 499);
+        for (qint64 t = 520; t < 530; ++t) expected.push_back(t);
+        check(series, expected, "after the first crash");
+        CHECK(series.commit(), "commit");
+        // lost again, only the slots of 446..448 are reused
+        for (qint64 t = 530; t < 533; ++t) series.append(t, t);
+        crash(first, second);
+    }
+    {
+        // the stale 513..519 are older than the newest committed sample by now, only the
+        // committed start of the readable slots keeps them out
+        TimeSeries series("crash", second, options());
+        CHECK(series.open(), "open after the second crash");
+        std::vector<qint64> expected = span(456, 499);
+        for (qint64 t = 520; t < 530; ++t) expected.push_back(t);
+        check(series, expected, "second crash");
+        // appending moves past the skipped slots again
+        for (qint64 t = 1000; t < 1100; ++t) series.append(t, t);
+        check(series, span(1036, 1099), "appended over the skipped slots");
+    }
+    QFile::remove(path);
+    QFile::remove(first);
+    QFile::remove(second);
+}
+
+// samples may share a time; lost ones with the newest committed time are skipped only when
+// an older sample follows them
+static void equalTimes() {
+    const QString path("timeseries_test_equal.ring"), copy("timeseries_test_equal_crash.ring");
+    QFile::remove(path);
+    {
+        TimeSeries series("equal", path, options());
+        CHECK(series.open(), "open");
+        for (qint64 t = 0; t < 100; ++t) series.append(t < 80 ? t : 80, t);
+        CHECK(series.commit(), "commit");
+        for (qint64 t = 0; t < 5; ++t) series.append(80, t);
+        crash(path, copy);
+    }
+    TimeSeries series("equal", copy, options());
+    CHECK(series.open(), "open after the crash");
+    std::vector<qint64> expected = span(41, 79);
+    for (int i = 0; i < 20; ++i) expected.push_back(80);
+    check(series, expected, "equal times");
+    QFile::remove(path);
+    QFile::remove(copy);
+}
+
+int main() {
+    clean();
+    wrapped();
+    equalTimes();
+    std::printf("%s\n", failures ? "FAILED" : "OK");
+    return failures != 0;
+}
@@ -0,0 +1,220 @@
+/* Wet_bulb_solve convergence, iteration counts and the edges of its bracket; prints every
+    failed check and exits non-zero if there was one.
+
+        gcc -std=c99 -O2 -pthread -I.. wet_bulb_test.c ../psychropy.c -lm -o wet_bulb_test
+        ./wet_bulb_test
+*/
+#include <math.h>
+#include <stdio.h>
+#include "psychropy.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                         \
+    do {                                                         \
+        if (!(cond)) {                                           \
+            printf("%s:%d: %s: ", __FILE__, __LINE__, #cond);    \
+            printf(__VA_ARGS__);                                 \
+            printf("\n");                                        \
+            ++failures;                                          \
+        }                                                        \
+    } while (0)
+
+// ambient pressure, raised where saturation would reach it
+static double pressure(double Tdb) {
+    double Pws = Sat_press(Tdb);
+    return Pws < 50 ? 101.325 : 2 * Pws + 10;
+}
+
+// over -100..200 C and RH 0..1 every state either converges to a root of
+// Hum_rat(Tdb, Twb, P) = Hum_rat2(Tdb, RH, P) inside the bracket or, at Tdb = -100 C only,
+// reports that the root lies below the bracket
+static void convergence(void) {
+    int worst = 0, states = 0, i;
+    double Tdb, RH;
+    for (Tdb = -100; Tdb <= 200; Tdb += 0.5) {
+        for (i = 0; i <= 20; ++i) {
+            double P = pressure(Tdb), Twb = 0, W = 0;
+            int iterations = 0, status = 0;
+            RH = i / 20.0;
+            status = Wet_bulb_solve(Tdb, RH, P, NAN, &Twb, &iterations);
+            ++states;
+            CHECK(status != PSYCH_ENOCONV, "Tdb %g RH %g", Tdb, RH);
+            CHECK(iterations >= 1 && iterations <= PSYCH_WET_BULB_MAX_ITER, "%d", iterations);
+            if (iterations > worst) worst = iterations;
+            if (Tdb == -100 && RH < 1) {
+                CHECK(status == PSYCH_EDOMAIN && isnan(Twb), "Tdb -100 RH %g: %d", RH, status);
+                continue;
+            }
+            CHECK(status == PSYCH_OK, "Tdb %g RH %g: %d", Tdb, RH, status);
+            CHECK(Twb >= -100 && Twb <= Tdb, "Tdb %g RH %g: Twb %g", Tdb, RH, Twb);
+            W = Hum_rat2(Tdb, RH, P);
+            CHECK(fabs(Hum_rat(Tdb, Twb, P) - W) <= 1e-9 * W + 1e-15,
+                  "Tdb %g RH %g: residual %g", Tdb, RH, Hum_rat(Tdb, Twb, P) - W);
+        }
+    }
+    // a cold start from Tdb takes a handful of Newton steps, never the bisection worst case
+    CHECK(worst <= 10, "worst case %d iterations", worst);
+    printf("convergence: %d states, worst %d iterations\n", states, worst);
+}
+
+static void saturation(void) {
+    double Tdb;
+    for (Tdb = -100; Tdb <= 200; Tdb += 0.25) {
+        double Twb = 0;
+        int iterations = 0;
+        int status = Wet_bulb_solve(Tdb, 1, pressure(Tdb), NAN, &Twb, &iterations);
+        CHECK(status == PSYCH_OK && fabs(Twb - Tdb) <= 1e-9, "Tdb %g: %d %.12g", Tdb, status,
+              Twb);
+        CHECK(iterations == 1, "Tdb %g: %d iterations", Tdb, iterations);
+    }
+}
+
+static void dry(void) {
+    double Twb = 0;
+    int iterations = 0;
+    CHECK(Wet_bulb_solve(25, 0, 101.325, NAN, &Twb, &iterations) == PSYCH_OK, "RH 0");
+    CHECK(Twb > 8 && Twb < 9, "%g", Twb);
+    CHECK(Hum_rat(25, Twb, 101.325) <= 1e-12, "%g", Hum_rat(25, Twb, 101.325));
+}
+
+static void domain(void) {
+    const double RH[] = {-0.01, 1.01, NAN, INFINITY};
+    const double P[] = {0, -1, Sat_press(30), Sat_press(30) * 0.5, NAN};
+    const double Tdb[] = {-100.01, 200.01, NAN, -INFINITY, INFINITY};
+    double Twb = 0;
+    int iterations = 0, i;
+    for (i = 0; i < 4; ++i) {
+        iterations = -1;
+        CHECK(Wet_bulb_solve(30, RH[i], 101.325, NAN, &Twb, &iterations) == PSYCH_EDOMAIN,
+              "RH %g", RH[i]);
+        CHECK(isnan(Twb) && iterations == 0, "RH %g: %g %d", RH[i], Twb, iterations);
+        CHECK(isnan(Wet_bulb(30, RH[i], 101.325)), "RH %g", RH[i]);
+    }
+    for (i = 0; i < 5; ++i) {
+        CHECK(Wet_bulb_solve(30, 0.5, P[i], NAN, &Twb, &iterations) == PSYCH_EDOMAIN,
+              "P %g", P[i]);
+        CHECK(isnan(Twb), "P %g: %g", P[i], Twb);
+    }
+    for (i = 0; i < 5; ++i) {
+        CHECK(Wet_bulb_solve(Tdb[i], 0.5, 101.325, NAN, &Twb, &iterations) == PSYCH_EDOMAIN,
+              "Tdb %g", Tdb[i]);
+        CHECK(isnan(Twb), "Tdb %g: %g", Tdb[i], Twb);
+    }
+    // the ends of the Sat_press range themselves are inside
+    CHECK(Wet_bulb_solve(200, 0.5, pressure(200), NAN, &Twb, &iterations) == PSYCH_OK, "200 C");
+    CHECK(Wet_bulb_solve(-100, 1, 101.325, NAN, &Twb, &iterations) == PSYCH_OK, "-100 C");
+    CHECK(Twb == -100, "%g", Twb);
+    CHECK(Wet_bulb_solve(-100, 0.5, 101.325, NAN, &Twb, &iterations) == PSYCH_EDOMAIN,
+          "root below -100 C");
+}
+
+// Sat_press changes formula at 0 C with a small jump, a root at or next to it must not fall
+// back to bisection
+static void kink(void) {
+    double Tdb;
+    for (Tdb = 0.25; Tdb <= 9; Tdb += 0.25) {
+        double Twb = 0, RH = Rel_hum(Tdb, 0, 101.325);
+        int iterations = 0, j;
+        for (j = -2; j <= 2; ++j) {
+            double shifted = RH * (1 + j * 1e-9);
+            CHECK(Wet_bulb_solve(Tdb, shifted, 101.325, NAN, &Twb, &iterations) == PSYCH_OK,
+                  "Tdb %g RH %.12g", Tdb, shifted);
+            CHECK(fabs(Twb) <= 1e-6, "Tdb %g RH %.12g: Twb %g", Tdb, shifted, Twb);
+            CHECK(iterations <= 8, "Tdb %g RH %.12g: %d iterations", Tdb, shifted, iterations);
+        }
+    }
+}
+
+// a guess outside (-100, Tdb) or not a number starts at Tdb, one inside only changes the
+// path; every start ends on the same root
+static void guesses(void) {
+    const double guess[] = {NAN, INFINITY, -INFINITY, 1000, 30, -100, -150, 17.9, 0, -99};
+    double cold = 0, Twb = 0;
+    int iterations = 0, coldIterations = 0, i;
+    CHECK(Wet_bulb_solve(30, 0.4, 101.325, NAN, &cold, &coldIterations) == PSYCH_OK, "cold");
+    for (i = 0; i < 10; ++i) {
+        CHECK(Wet_bulb_solve(30, 0.4, 101.325, guess[i], &Twb, &iterations) == PSYCH_OK,
+              "guess %g", guess[i]);
+        CHECK(fabs(Twb - cold) <= 1e-9, "guess %g: %.12g vs %.12g", guess[i], Twb, cold);
+        CHECK(iterations <= PSYCH_WET_BULB_MAX_ITER, "guess %g: %d", guess[i], iterations);
+    }
+    // starting next to the root saves steps
+    CHECK(Wet_bulb_solve(30, 0.4, 101.325, cold + 0.01, &Twb, &iterations) == PSYCH_OK,
+          "warm");
+    CHECK(iterations < coldIterations, "%d vs %d", iterations, coldIterations);
+}
+
+// the batched form starts every element cold, reordering the input reorders the output only
+static void batched(void) {
+    enum { N = 64 };
+    double Tdb[N], RH[N], P[N], out[N], reversed[N], rTdb[N], rRH[N], rP[N];
+    int i;
+    for (i = 0; i < N; ++i) {
+        Tdb[i] = -40 + 3.0 * i;
+        RH[i] = (i % 11) / 10.0;
+        P[i] = pressure(Tdb[i]);
+        rTdb[N - 1 - i] = Tdb[i];
+        rRH[N - 1 - i] = RH[i];
+        rP[N - 1 - i] = P[i];
+    }
+    Wet_bulb_n(Tdb, RH, P, out, N);
+    Wet_bulb_n(rTdb, rRH, rP, reversed, N);
+    for (i = 0; i < N; ++i) {
+        double Twb = Wet_bulb(Tdb[i], RH[i], P[i]);
+        CHECK(out[i] == Twb || (isnan(out[i]) && isnan(Twb)), "%d: %.17g vs %.17g", i, out[i],
+              Twb);
+        CHECK(out[i] == reversed[N - 1 - i], "%d: %.17g vs %.17g", i, out[i],
+              reversed[N - 1 - i]);
+    }
+}
+
+static void stream(void) {
+    psych_wet_bulb_stream s;
+    double Tdb, last = NAN;
+    int warm = 0, cold = 0;
+    psych_wet_bulb_stream_init(&s);
+    for (Tdb = 20; Tdb < 30; Tdb += 0.1) {
+        double Twb = 0;
+        int iterations = 0;
+        last = Wet_bulb_next(&s, Tdb, 0.5, 101.325);
+        CHECK(s.status == PSYCH_OK && s.Twb == last, "Tdb %g", Tdb);
+        Wet_bulb_solve(Tdb, 0.5, 101.325, NAN, &Twb, &iterations);
+        CHECK(fabs(Twb - last) <= 1e-9, "Tdb %g: %.12g vs %.12g", Tdb, last, Twb);
+        warm += s.iterations;
+        cold += iterations;
+    }
+    CHECK(warm < cold, "warm %d cold %d", warm, cold);
+    // a failed sample keeps the last good starting point
+    CHECK(isnan(Wet_bulb_next(&s, 25, 2, 101.325)) && s.status == PSYCH_EDOMAIN, "RH 2");
+    CHECK(s.Twb == last, "%g vs %g", s.Twb, last);
+}
+
+// RH 1 stays on the saturation line in every accuracy mode
+static void accuracy(void) {
+    int mode;
+    for (mode = PSYCH_ACCURACY_REFERENCE; mode <= PSYCH_ACCURACY_FAST; ++mode) {
+        double Tdb;
+        // a table Sat_press moves the root off Tdb by its own error, a few nK with FAST
+        const double tolerance = mode == PSYCH_ACCURACY_FAST ? 1e-8 : 1e-9;
+        psych_set_accuracy((psych_accuracy)mode);
+        for (Tdb = -99.5; Tdb <= 199.5; Tdb += 0.5)
+            CHECK(fabs(Wet_bulb(Tdb, 1, pressure(Tdb)) - Tdb) <= tolerance, "mode %d Tdb %g",
+                  mode, Tdb);
+    }
+    psych_set_accuracy(PSYCH_ACCURACY_REFERENCE);
+}
+
+int main(void) {
+    convergence();
+    saturation();
+    dry();
+    domain();
+    kink();
+    guesses();
+    batched();
+    stream();
+    accuracy();
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures != 0;
+}
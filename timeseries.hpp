@@ -0,0 +1,456 @@
+#ifndef TIMESERIES_HPP
+#define TIMESERIES_HPP
+
+#include <sys/mman.h>
+#include <QFile>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+#include "worm.hpp"
+
+namespace WORM {
+
+// geometry of a TimeSeries file, a file found with another geometry is started over
+struct TimeSeriesOptions {
+    enum { Tiers = 3 };
+    // slots of raw samples, then of each tier; the defaults keep 1 s for two days,
+    // 1 min for 90 days and 1 h for five years
+    qint64 capacity[Tiers + 1] = {1 << 18, 172800, 129600, 43800};
+    // bucket length of each tier in ms
+    qint64 period[Tiers] = {1000, 60000, 3600000};
+    // tiers handed to WORM by archive(), bit i for tier i + 1
+    unsigned archive = 0x7;
+};
+
+// one closed bucket as handed to WORM, for a table like
+// create table timeseries (channel varchar(64), period bigint, time bigint, minimum double,
+//         maximum double, mean double, count bigint, primary key (channel, period, time))
+class TimeSeriesRow {
+public:
+    QString channel;
+    qint64 period{0};
+    qint64 time{0};
+    double minimum{0};
+    double maximum{0};
+    double mean{0};
+    qint64 count{0};
+    ORMAP("timeseries", channel, period, time, minimum, maximum, mean, count)
+};
+
+// one channel in a fixed-size memory-mapped file: a ring of raw samples and a ring of
+// min/max/mean buckets per tier, all updated on append(); one thread appends, any thread
+// reads without copying. The header keeps two checksummed commit records written in turn,
+// so after a crash open() resumes from the last commit() and slots written later are reused;
+// where those had wrapped over the oldest committed slots, open() skips them
+class TimeSeries {
+public:
+    enum { Tiers = TimeSeriesOptions::Tiers, Levels = Tiers + 1 };
+
+    struct Sample {
+        qint64 time;  // ms since epoch
+        double value;
+    };
+
+    struct Bucket {
+        qint64 time;  // start of the bucket
+        double min;
+        double max;
+        double mean;
+        qint64 count;
+    };
+
+    // consecutive slots of one level, in two parts where the ring wraps
+    template <typename T> struct Range {
+        const T* part[2];
+        qint64 size[2];
+        int level;
+        quint64 index;  // position of the first slot
+
+        qint64 count() const { return size[0] + size[1]; }
+        const T& at(qint64 i) const { return i < size[0] ? part[0][i] : part[1][i - size[0]]; }
+    };
+
+    TimeSeries(const QString& name,
+               const QString& path,
+               const TimeSeriesOptions& options = TimeSeriesOptions())
+        : name_(name), file_(path), options_(options) {
+        for (int i = 0; i < Levels; ++i) Q_ASSERT(options.capacity[i] > 0);
+        for (int i = 0; i < Tiers; ++i) Q_ASSERT(options.period[i] > 0);
+    }
+
+    ~TimeSeries() { close(); }
+
+    TimeSeries(const TimeSeries&) = delete;
+    TimeSeries& operator=(const TimeSeries&) = delete;
+
+    bool open() {
+        close();
+        const qint64 size = layout();
+        if (!file_.open(QIODevice::ReadWrite)) return false;
+        const bool resized = file_.size() != size;
+        if ((resized && !file_.resize(size)) || !(map_ = file_.map(0, size))) {
+            file_.close();
+            return false;
+        }
+        size_ = size;
+        const Commit* last = resized || !matches() ? nullptr : latest();
+        if (!last) {
+            initialize();
+            last = &header()->commit[0];
+        }
+        sequence_ = last->sequence;
+        for (int i = 0; i < Levels; ++i) {
+            head_[i].store(last->head[i], std::memory_order_relaxed);
+            archived_[i].store(last->archived[i], std::memory_order_relaxed);
+            const quint64 first = qMin(last->first[i], last->head[i]);
+            first_[i] = i == 0 ? recover<Sample>(i, first, last->head[i])
+                               : recover<Bucket>(i, first, last->head[i]);
+        }
+        const quint64 head = last->head[0];
+        last_ = head ? slot<Sample>(0, head - 1).time : std::numeric_limits<qint64>::min();
+        return true;
+    }
+
+    // commits and unmaps, appending must have stopped
+    void close() {
+        if (!map_) return;
+        commit();
+        file_.unmap(map_);
+        map_ = nullptr;
+        file_.close();
+    }
+
+    bool isOpen() const { return map_; }
+
+    const QString& name() const { return name_; }
+
+    // times must not decrease, an older sample is rejected
+    bool append(qint64 time, double value) {
+        if (!map_ || time < last_) return false;
+        last_ = time;
+        const quint64 raw = head_[0].load(std::memory_order_relaxed);
+        slot<Sample>(0, raw) = Sample{time, value};
+        head_[0].store(raw + 1, std::memory_order_release);
+        for (int i = 1; i < Levels; ++i) {
+            const qint64 period = options_.period[i - 1];
+            const qint64 start = time - ((time % period) + period) % period;
+            const quint64 head = head_[i].load(std::memory_order_relaxed);
+            Bucket* current = head ? &slot<Bucket>(i, head - 1) : nullptr;
+            if (current && current->time == start) {
+                current->min = std::min(current->min, value);
+                current->max = std::max(current->max, value);
+                current->mean += (value - current->mean) / ++current->count;
+            } else {
+                slot<Bucket>(i, head) = Bucket{start, value, value, value, 1};
+                head_[i].store(head + 1, std::memory_order_release);
+            }
+        }
+        return true;
+    }
+
+    // raw samples with from <= time <= to
+    Range<Sample> samples(qint64 from, qint64 to) const {
+        const quint64 head = head_[0].load(std::memory_order_acquire);
+        const quint64 lo = upper<Sample>(0, oldest(0, head), head, from - 1);
+        return range<Sample>(0, lo, qMax(lo, upper<Sample>(0, lo, head, to)));
+    }
+
+    // buckets of tier 1..Tiers overlapping [from, to]; the newest one is still open and
+    // changes while samples arrive
+    Range<Bucket> buckets(int tier, qint64 from, qint64 to) const {
+        Q_ASSERT(tier > 0 && tier < Levels);
+        const quint64 head = head_[tier].load(std::memory_order_acquire);
+        const quint64 lo =
+                upper<Bucket>(tier, oldest(tier, head), head, from - options_.period[tier - 1]);
+        return range<Bucket>(tier, lo, qMax(lo, upper<Bucket>(tier, lo, head, to)));
+    }
+
+    // finest level, 0 for raw samples, with at most points slots in [from, to], so a chart
+    // reads O(pixels) slots; the coarsest tier when none fits
+    int level(qint64 from, qint64 to, qint64 points) const {
+        if (samples(from, to).count() <= points) return 0;
+        for (int i = 1; i < Tiers; ++i)
+            if (buckets(i, from, to).count() <= points) return i;
+        return Tiers;
+    }
+
+    // false once append() has overwritten part of range, read it again then
+    template <typename T> bool intact(const Range<T>& range) const {
+        const quint64 head = head_[range.level].load(std::memory_order_acquire);
+        return head < range.index + quint64(options_.capacity[range.level]);
+    }
+
+    // makes everything appended so far durable, safe to call from another thread than the
+    // appending one; the only call that syncs, so it bounds how often the flash is written
+    bool commit() {
+        QMutexLocker l(&mutex_);
+        if (!map_) return false;
+        Commit commit;
+        std::memset(&commit, 0, sizeof(commit));
+        commit.sequence = sequence_ + 1;
+        for (int i = 0; i < Levels; ++i) {
+            commit.head[i] = head_[i].load(std::memory_order_acquire);
+            commit.archived[i] = archived_[i].load(std::memory_order_relaxed);
+            commit.first[i] = first_[i];
+        }
+        commit.checksum = checksum(commit);
+        // slots first, the record must never point at slots still in the page cache
+        if (msync(map_, size_, MS_SYNC) != 0) return false;
+        header()->commit[commit.sequence & 1] = commit;
+        if (msync(map_, HeaderSize, MS_SYNC) != 0) return false;
+        sequence_ = commit.sequence;
+        return true;
+    }
+
+    // hands the closed buckets of the archived tiers to WORM, batchRows per statement; rows
+    // are replaced so buckets sent again after a crash do no harm. Returns the rows handed
+    // over or -1 when a batch failed, it is retried on the next call
+    int archive(int batchRows = 500) {
+        int total = 0;
+        for (int i = 1; i < Levels; ++i) {
+            if (!(options_.archive >> (i - 1) & 1)) continue;
+            const quint64 head = head_[i].load(std::memory_order_acquire);
+            const quint64 closed = head ? head - 1 : 0;
+            quint64 next = qMax(archived_[i].load(std::memory_order_relaxed), oldest(i, head));
+            while (next < closed) {
+                const quint64 first = next;
+                QVector<TimeSeriesRow> rows;
+                rows.reserve(int(qMin(closed - next, quint64(batchRows))));
+                for (; next < closed && rows.size() < batchRows; ++next) {
+                    const Bucket& bucket = slot<Bucket>(i, next);
+                    TimeSeriesRow row;
+                    row.channel = name_;
+                    row.period = options_.period[i - 1];
+                    row.time = bucket.time;
+                    row.minimum = bucket.min;
+                    row.maximum = bucket.max;
+                    row.mean = bucket.mean;
+                    row.count = bucket.count;
+                    rows.push_back(row);
+                }
+                // append() may have lapped the oldest rows while they were copied
+                const quint64 valid = oldest(i, head_[i].load(std::memory_order_acquire) + 1);
+                if (valid > first) rows.remove(0, int(qMin(valid - first, quint64(rows.size()))));
+                if (QueryHelper::bulk(rows, QueryHelper::WriteMode::Replace) < 0) return -1;
+                archived_[i].store(next, std::memory_order_relaxed);
+                total += rows.size();
+            }
+        }
+        return total;
+    }
+
+private:
+    enum : quint32 { Version = 1 };
+    enum : qint64 { HeaderSize = 4096 };
+
+    struct Commit {
+        quint64 sequence;
+        quint64 head[Levels];      // slots ever appended per level
+        quint64 archived[Levels];  // buckets handed to WORM per tier
+        quint64 first[Levels];     // oldest readable slot per level, see recover()
+        quint64 checksum;
+    };
+
+    struct Header {
+        char magic[8];
+        quint32 version;
+        quint32 levels;
+        qint64 capacity[Levels];
+        qint64 period[Levels];  // 0 for raw samples
+        Commit commit[2];       // written in turn, the valid one with the higher sequence wins
+    };
+    static_assert(sizeof(Header) <= HeaderSize, "TimeSeries header exceeds its page");
+
+    // byte offsets of the levels after the header page, returns the file size
+    qint64 layout() {
+        qint64 offset = HeaderSize;
+        for (int i = 0; i < Levels; ++i) {
+            offset_[i] = offset;
+            offset += options_.capacity[i] * (i == 0 ? sizeof(Sample) : sizeof(Bucket));
+            offset = (offset + 63) & ~qint64(63);
+        }
+        return offset;
+    }
+
+    Header* header() const { return reinterpret_cast<Header*>(map_); }
+
+    template <typename T> T& slot(int level, quint64 index) const {
+        return reinterpret_cast<T*>(map_ + offset_[level])[index % options_.capacity[level]];
+    }
+
+    quint64 oldest(int level, quint64 head) const { return oldest(level, first_[level], head); }
+
+    quint64 oldest(int level, quint64 first, quint64 head) const {
+        const quint64 capacity = options_.capacity[level];
+        return qMax(first, head > capacity ? head - capacity : 0);
+    }
+
+    // oldest readable position of a level on open(): once the ring is full, slots appended
+    // after the last commit() have overwritten the oldest committed ones with later times.
+    // Those lead the ring and would leave it unsorted for upper(), so they stay skipped,
+    // across later commits too, until append() has reused them. Only the leading slots that
+    // are not older than the newest committed one are read. first is the committed one, first_
+    // is not set yet
+    template <typename T> quint64 recover(int level, quint64 first, quint64 head) const {
+        const quint64 lo = oldest(level, first, head);
+        if (head - lo < 2) return lo;
+        const qint64 newest = slot<T>(level, head - 1).time;
+        quint64 ret = lo, next = lo;
+        for (; next < head - 1 && slot<T>(level, next).time >= newest; ++next)
+            if (slot<T>(level, next).time > newest) ret = next + 1;
+        // ahead of an older slot even the ones with the newest time were overwritten
+        return next < head - 1 ? next : ret;
+    }
+
+    // first position in [lo, hi) with a time after key
+    template <typename T> quint64 upper(int level, quint64 lo, quint64 hi, qint64 key) const {
+        while (lo < hi) {
+            const quint64 mid = lo + (hi - lo) / 2;
+            if (slot<T>(level, mid).time > key)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        return lo;
+    }
+
+    template <typename T> Range<T> range(int level, quint64 lo, quint64 hi) const {
+        const qint64 capacity = options_.capacity[level];
+        const qint64 start = qint64(lo % capacity);
+        const qint64 count = qint64(hi - lo);
+        const T* base = reinterpret_cast<const T*>(map_ + offset_[level]);
+        Range<T> ret;
+        ret.part[0] = base + start;
+        ret.size[0] = qMin(count, capacity - start);
+        ret.part[1] = base;
+        ret.size[1] = count - ret.size[0];
+        ret.level = level;
+        ret.index = lo;
+        return ret;
+    }
+
+    // FNV-1a over everything before the checksum
+    static quint64 checksum(const Commit& commit) {
+        const uchar* p = reinterpret_cast<const uchar*>(&commit);
+        quint64 hash = 14695981039346656037ull;
+        for (size_t i = 0; i < offsetof(Commit, checksum); ++i)
+            hash = (hash ^ p[i]) * 1099511628211ull;
+        return hash;
+    }
+
+    bool matches() const {
+        const Header* h = header();
+        if (std::memcmp(h->magic, "WORMRING", 8) != 0 || h->version != Version ||
+            h->levels != Levels)
+            return false;
+        for (int i = 0; i < Levels; ++i)
+            if (h->capacity[i] != options_.capacity[i] ||
+                h->period[i] != (i == 0 ? 0 : options_.period[i - 1]))
+                return false;
+        return true;
+    }
+
+    const Commit* latest() const {
+        const Commit* ret = nullptr;
+        for (const auto& it : header()->commit)
+            if (it.checksum == checksum(it) && (!ret || it.sequence > ret->sequence)) ret = &it;
+        return ret;
+    }
+
+    void initialize() {
+        Header* h = header();
+        std::memset(h, 0, sizeof(Header));
+        std::memcpy(h->magic, "WORMRING", 8);
+        h->version = Version;
+        h->levels = Levels;
+        for (int i = 0; i < Levels; ++i) {
+            h->capacity[i] = options_.capacity[i];
+            h->period[i] = i == 0 ? 0 : options_.period[i - 1];
+        }
+        h->commit[0].checksum = checksum(h->commit[0]);
+        h->commit[1].checksum = ~h->commit[0].checksum;
+        msync(map_, HeaderSize, MS_SYNC);
+    }
+
+    const QString name_;
+    QFile file_;
+    const TimeSeriesOptions options_;
+    uchar* map_{nullptr};
+    qint64 size_{0};
+    qint64 offset_[Levels]{};
+
+    std::atomic<quint64> head_[Levels]{};
+    std::atomic<quint64> archived_[Levels]{};
+    quint64 first_[Levels]{};  // set by open() only
+    qint64 last_{0};
+    quint64 sequence_{0};
+    QMutex mutex_;
+};
+
+// background job handing the tiers of several channels to WORM and committing them, on a
+// connection the job opens for itself
+class TimeSeriesArchiver : public QThread {
+public:
+    TimeSeriesArchiver(int interval = 10000, int batchRows = 500)
+        : interval_(interval), batchRows_(batchRows) {}
+
+    ~TimeSeriesArchiver() { stop(); }
+
+    // before start()
+    void add(TimeSeries* series) { series_.push_back(series); }
+
+    // runs a last round, then returns
+    void stop() {
+        if (!isRunning()) return;
+        {
+            QMutexLocker l(&mutex_);
+            stopping_ = true;
+            cond_.wakeOne();
+        }
+        wait();
+    }
+
+    qint64 archived() const { return archived_.load(std::memory_order_relaxed); }
+    int failures() const { return failures_.load(std::memory_order_relaxed); }
+
+protected:
+    void run() override {
+        const DatabaseHelper::ThreadDB db(DatabaseHelper::Role::Write);
+        while (true) {
+            bool stopping;
+            {
+                QMutexLocker l(&mutex_);
+                if (!stopping_) cond_.wait(&mutex_, interval_);
+                stopping = stopping_;
+            }
+            for (auto it : series_) {
+                const int rows = it->archive(batchRows_);
+                if (rows < 0)
+                    failures_.fetch_add(1, std::memory_order_relaxed);
+                else
+                    archived_.fetch_add(rows, std::memory_order_relaxed);
+                it->commit();
+            }
+            if (stopping) break;
+        }
+    }
+
+private:
+    const int interval_;
+    const int batchRows_;
+    QVector<TimeSeries*> series_;
+    std::atomic<qint64> archived_{0};
+    std::atomic<int> failures_{0};
+
+    QMutex mutex_;
+    QWaitCondition cond_;
+    bool stopping_{false};
+};
+
+}  // namespace WORM
+
+#endif  // TIMESERIES_HPP
@@ -1,52 +1,1099 @@
+#ifndef WORM_HPP
+#define WORM_HPP
+
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QMutex>
+#include <QQueue>
+#include <QSet>
+#include <QSqlDriver>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QSqlRecord>
+#include <QThread>
 #include <QVariant>
 #include <QVector>
+#include <QWaitCondition>
+#include <QtAlgorithms>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace WORM {
 
+struct SerializationHelper {
+    template <typename T> static inline void serialize(const T& property, QVariantList& value) {
+        value << QVariant(property);
+    }
+
+    // rough wire size of a bound value, used to keep bulk chunks under max_allowed_packet
+    static inline int estimate(const QVariant& value) {
+        switch (value.type()) {
+        case QVariant::String:
+            return value.toString().size() * 3 + 2;
+        case QVariant::ByteArray:
+            return value.toByteArray().size() * 2 + 2;
+        default:
+            return 16;
+        }
+    }
+};
+
+struct DeserializationHelper {
+    template <typename T> static inline void deserialize(T& property, const QVariant& value) {
+        Q_ASSERT(value.canConvert<T>());
+        property = value.value<T>();
+    }
+
+    // typed readers for the common column types, picked at compile time from the member
+    // type, skip the canConvert/value<T>() metatype dispatch
+    static inline void deserialize(double& property, const QVariant& value) {
+        property = value.toDouble();
+    }
+    static inline void deserialize(float& property, const QVariant& value) {
+        property = value.toFloat();
+    }
+    static inline void deserialize(int& property, const QVariant& value) {
+        property = value.toInt();
+    }
+    static inline void deserialize(uint& property, const QVariant& value) {
+        property = value.toUInt();
+    }
+    static inline void deserialize(qint64& property, const QVariant& value) {
+        property = value.toLongLong();
+    }
+    static inline void deserialize(quint64& property, const QVariant& value) {
+        property = value.toULongLong();
+    }
+    static inline void deserialize(bool& property, const QVariant& value) {
+        property = value.toBool();
+    }
+    static inline void deserialize(QString& property, const QVariant& value) {
+        property = value.toString();
+    }
+    static inline void deserialize(QByteArray& property, const QVariant& value) {
+        property = value.toByteArray();
+    }
+    static inline void deserialize(QDateTime& property, const QVariant& value) {
+        property = value.toDateTime();
+    }
+};
+
+// struct-of-arrays result of QueryHelper::selectColumns, one std::vector per ORMAP field
+struct ColumnsOf {
+    template <typename... Args>
+    std::tuple<std::vector<std::decay_t<Args>>...> operator()(Args&...) const {
+        return {};
+    }
+};
+
+struct FieldName {
+    const char* data;
+    int size;
+};
+
+template <int N> struct FieldArray {
+    FieldName names[N];
+    constexpr int size() const { return N; }
+    constexpr const FieldName& operator[](int i) const { return names[i]; }
+};
+
+// values an ORKEY entity was last loaded or saved with; a copy or assignment is a new
+// identity, so a transaction never applies values queued for another entity
+struct Original : QVariantList {
+    Original() = default;
+    Original(const Original& other) : QVariantList(other) {}
+    Original& operator=(const Original& other) {
+        QVariantList::operator=(other);
+        alive_.reset();
+        return *this;
+    }
+    using QVariantList::operator=;
+
+    // expires with the entity, created the first time a transaction queues values for it
+    std::weak_ptr<char> token() {
+        if (!alive_) alive_ = std::make_shared<char>();
+        return alive_;
+    }
+
+private:
+    std::shared_ptr<char> alive_;
+};
+
+class InjectionHelper {
+    static constexpr bool isIdentifier(char ch) {
+        return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+               ch == '_';
+    }
+
+    template <typename C> static constexpr auto keyNames(int) -> decltype(C::__KeyNames) {
+        return C::__KeyNames;
+    }
+
+    template <typename C> static constexpr const char* keyNames(long) { return ""; }
+
+    template <typename C>
+    static inline auto original(const C& obj, int) -> decltype(&obj.__original) {
+        return &obj.__original;
+    }
+
+    template <typename C> static inline Original* original(const C&, long) { return nullptr; }
+
+public:
+    // ORMAP field list parsing, evaluated at compile time from #__VA_ARGS__
+    static constexpr int countFields(const char* input) {
+        int count = 0;
+        for (bool in = false; *input; ++input) {
+            if (isIdentifier(*input) && !in) ++count;
+            in = isIdentifier(*input);
+        }
+        return count;
+    }
+
+    // true when every identifier in names is also one in fields, checks ORKEY against ORMAP
+    static constexpr bool containsAll(const char* fields, const char* names) {
+        for (const char* p = names; *p;) {
+            int size = 0;
+            while (isIdentifier(p[size])) ++size;
+            if (size > 0 && !contains(fields, p, size)) return false;
+            p += size > 0 ? size : 1;
+        }
+        return true;
+    }
+
+    static constexpr bool contains(const char* fields, const char* name, int size) {
+        for (const char* p = fields; *p;) {
+            int length = 0;
+            while (isIdentifier(p[length])) ++length;
+            bool same = length == size;
+            for (int i = 0; same && i < size; ++i) same = p[i] == name[i];
+            if (same) return true;
+            p += length > 0 ? length : 1;
+        }
+        return false;
+    }
+
+    template <int N> static constexpr FieldArray<N> parseFields(const char* input) {
+        FieldArray<N> ret{};
+        int index = 0;
+        const char* begin = nullptr;
+        for (const char* p = input;; ++p) {
+            if (isIdentifier(*p)) {
+                if (!begin) begin = p;
+            } else {
+                if (begin && index < N) ret.names[index++] = FieldName{begin, int(p - begin)};
+                begin = nullptr;
+                if (!*p) break;
+            }
+        }
+        return ret;
+    }
+
+    template <typename C, typename Fn> static inline decltype(auto) visit(C& obj, Fn fn) {
+        return obj.__accept(fn);
+    }
+
+    template <typename C> static constexpr int fieldCount() { return C::__FieldCount; }
+
+    template <typename C> static constexpr FieldArray<C::__FieldCount> fieldArray() {
+        return C::__Fields();
+    }
+
+    template <typename C> static inline const QStringList& fieldNames() {
+        static const QStringList fieldNames = [] {
+            QStringList ret;
+            constexpr auto fields = fieldArray<C>();
+            for (int i = 0; i < fields.size(); ++i)
+                ret << QString::fromLatin1(fields[i].data, fields[i].size);
+            return ret;
+        }();
+        return fieldNames;
+    }
+
+    template <typename C> static inline const QString& tableName() {
+        static const QString tableName{C::__TableName};
+        return tableName;
+    }
+
+    template <typename C> static inline const QString& fields() {
+        static const QString fields = fieldNames<C>().join(',');
+        return fields;
+    }
+
+    template <typename C> static inline const QString& placeholders() {
+        static const QString placeholders = [] {
+            QStringList ret;
+            for (int i = 0; i < fieldNames<C>().size(); ++i) ret << "?";
+            return ret.join(',');
+        }();
+        return placeholders;
+    }
+
+    template <typename C> static inline const QString& assignments() {
+        static const QString assignments = [] {
+            QStringList ret;
+            for (const auto& it : fieldNames<C>()) ret << QString("%1 = ?").arg(it);
+            return ret.join(',');
+        }();
+        return assignments;
+    }
+
+    // assignments of the non-key fields from the conflicting row, empty when every field
+    // is part of the key
+    template <typename C> static inline const QString& upserts(bool sqlite) {
+        static const QString upserts[2] = {nonKeyAssignments<C>("%1 = values(%1)"),
+                                           nonKeyAssignments<C>("%1 = excluded.%1")};
+        return upserts[sqlite];
+    }
+
+    template <typename C> static inline const QString& keys() {
+        static const QString keys = [] {
+            QStringList ret;
+            for (int it : keyIndexes<C>()) ret << fieldNames<C>().at(it);
+            return ret.join(',');
+        }();
+        return keys;
+    }
+
+    // field indexes named by ORKEY, empty for entities without a key
+    template <typename C> static inline const QVector<int>& keyIndexes() {
+        static const QVector<int> keyIndexes = [] {
+            QVector<int> ret;
+            QString name;
+            for (const char* p = keyNames<C>(0);; ++p) {
+                if (isIdentifier(*p)) {
+                    name += QLatin1Char(*p);
+                } else {
+                    // ORKEY has already rejected names missing from ORMAP at compile time
+                    if (!name.isEmpty()) ret << fieldNames<C>().indexOf(name);
+                    name.clear();
+                    if (!*p) break;
+                }
+            }
+            return ret;
+        }();
+        return keyIndexes;
+    }
+
+    template <typename C> static inline const QString& keyCondition() {
+        static const QString keyCondition = [] {
+            QStringList ret;
+            for (int it : keyIndexes<C>()) ret << QString("%1 = ?").arg(fieldNames<C>().at(it));
+            return ret.join(" and ");
+        }();
+        return keyCondition;
+    }
+
+    // values an ORKEY entity was last loaded or saved with, nullptr if it does not track them
+    template <typename C> static inline Original* original(const C& obj) {
+        return original(obj, 0);
+    }
+
+private:
+    template <typename C> static inline QString nonKeyAssignments(const char* format) {
+        QStringList ret;
+        for (int i = 0; i < fieldNames<C>().size(); ++i)
+            if (!keyIndexes<C>().contains(i)) ret << QString(format).arg(fieldNames<C>().at(i));
+        return ret.join(',');
+    }
+
+public:
+
+    template <typename C> static constexpr quint64 allFields() {
+        return C::__FieldCount >= 64 ? ~0ull : (1ull << C::__FieldCount) - 1;
+    }
+
+    // bit i set when field i differs from the tracked original, all bits without one
+    template <typename C> static inline quint64 dirty(const C& obj, const QVariantList& values) {
+        const QVariantList* before = original(obj);
+        if (!before || before->size() != values.size()) return allFields<C>();
+        quint64 mask = 0;
+        for (int i = 0; i < values.size(); ++i)
+            if (values.at(i) != before->at(i)) mask |= 1ull << i;
+        return mask;
+    }
+};
+
+// opt-in read-through cache for QueryHelper::select, keyed on (table, statement);
+// any write through WORM to a table drops its entries
+struct CacheHelper {
+    struct Entry {
+        std::shared_ptr<const void> data_;
+        qint64 bytes_;
+        QElapsedTimer age_;
+    };
+
+    static QMutex mutex;
+    // cached tables and their time to live in ms
+    static QHash<QString, int> ttl;
+    static QHash<QPair<QString, QString>, Entry> entries;
+    // bumped by every write, a select only stores its result if no write ran meanwhile
+    static QHash<QString, quint64> generations;
+    static qint64 capacity;
+    static qint64 size;
+    static quint64 hits;
+    static quint64 misses;
+
+    template <typename T> static inline void enable(int ms = 60000) {
+        QMutexLocker l(&mutex);
+        ttl.insert(InjectionHelper::tableName<T>(), ms);
+    }
+
+    template <typename T> static inline void disable() {
+        invalidate(InjectionHelper::tableName<T>());
+        QMutexLocker l(&mutex);
+        ttl.remove(InjectionHelper::tableName<T>());
+    }
+
+    static inline bool enabled(const QString& table) {
+        QMutexLocker l(&mutex);
+        return ttl.contains(table);
+    }
+
+    // bindings carry their type and null state, so NULL, "" and 0 make different keys
+    static inline QString key(const QString& statement, const QVariantList& bindings) {
+        QStringList ret{statement};
+        for (const auto& it : bindings)
+            ret << QString::number(it.userType()) + (it.isNull() ? "!" : ":") + it.toString();
+        return ret.join(QChar(0x1f));
+    }
+
+    // heap bytes owned by a field beyond sizeof the entity
+    template <typename F> static inline qint64 payload(const F&) { return 0; }
+    static inline qint64 payload(const QString& value) { return value.capacity() * 2; }
+    static inline qint64 payload(const QByteArray& value) { return value.capacity(); }
+    static inline qint64 payload(const QVariant& value) {
+        return value.type() == QVariant::String      ? payload(value.toString())
+               : value.type() == QVariant::ByteArray ? payload(value.toByteArray())
+                                                     : 0;
+    }
+
+    static inline quint64 generation(const QString& table) {
+        QMutexLocker l(&mutex);
+        return generations.value(table);
+    }
+
+    // a hit shares the cached vector, Qt's copy-on-write keeps it immutable
+    template <typename T>
+    static inline bool find(const QString& table, const QString& key, QVector<T>& vec) {
+        QMutexLocker l(&mutex);
+        auto it = entries.find(qMakePair(table, key));
+        if (it == entries.end() || it->age_.hasExpired(ttl.value(table))) {
+            if (it != entries.end()) {
+                size -= it->bytes_;
+                entries.erase(it);
+            }
+            ++misses;
+            return false;
+        }
+        vec = *std::static_pointer_cast<const QVector<T>>(it->data_);
+        ++hits;
+        return true;
+    }
+
+    template <typename T>
+    static inline void insert(const QString& table,
+                              const QString& key,
+                              const QVector<T>& vec,
+                              quint64 generation) {
+        qint64 bytes = key.size() * 2 + qint64(vec.size()) * sizeof(T);
+        for (const auto& it : vec)
+            InjectionHelper::visit(it, [&bytes](const auto&... args) {
+                std::initializer_list<int>{(bytes += payload(args), 0)...};
+            });
+        QMutexLocker l(&mutex);
+        if (generations.value(table) != generation || bytes > capacity) return;
+        auto it = entries.find(qMakePair(table, key));
+        if (it != entries.end()) {
+            size -= it->bytes_;
+            entries.erase(it);
+        }
+        // evict the oldest entries until the new one fits
+        while (size + bytes > capacity && !entries.isEmpty()) {
+            auto oldest = entries.begin();
+            for (auto it = entries.begin(); it != entries.end(); ++it)
+                if (it->age_.elapsed() > oldest->age_.elapsed()) oldest = it;
+            size -= oldest->bytes_;
+            entries.erase(oldest);
+        }
+        Entry entry{std::make_shared<const QVector<T>>(vec), bytes, QElapsedTimer()};
+        entry.age_.start();
+        entries.insert(qMakePair(table, key), entry);
+        size += bytes;
+    }
+
+    // an empty table drops everything, used for free-form statements that wrote
+    static inline void invalidate(const QString& table) {
+        QMutexLocker l(&mutex);
+        if (ttl.isEmpty()) return;
+        if (table.isEmpty()) {
+            for (auto it = ttl.begin(); it != ttl.end(); ++it) ++generations[it.key()];
+            entries.clear();
+            size = 0;
+            return;
+        }
+        if (!ttl.contains(table)) return;
+        ++generations[table];
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (it.key().first == table) {
+                size -= it->bytes_;
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    static inline QJsonObject statistics() {
+        QMutexLocker l(&mutex);
+        QJsonObject ret;
+        ret["hits"] = double(hits);
+        ret["misses"] = double(misses);
+        ret["entries"] = entries.size();
+        ret["bytes"] = double(size);
+        return ret;
+    }
+};
+
+QMutex CacheHelper::mutex;
+QHash<QString, int> CacheHelper::ttl;
+QHash<QPair<QString, QString>, CacheHelper::Entry> CacheHelper::entries;
+QHash<QString, quint64> CacheHelper::generations;
+qint64 CacheHelper::capacity = 8 << 20;
+qint64 CacheHelper::size = 0;
+quint64 CacheHelper::hits = 0;
+quint64 CacheHelper::misses = 0;
+
+// log-linear latency histogram in microseconds, 8 sub-buckets per power of two (<= 12.5% error)
+class Histogram {
+    static constexpr int SubBits = 3;
+    static constexpr int Sub = 1 << SubBits;
+    static constexpr int Buckets = 40 * Sub;
+
+public:
+    void record(qint64 us) {
+        counts_[index(qMax<qint64>(us, 0))]++;
+        ++count_;
+        sum_ += us;
+        max_ = qMax(max_, us);
+    }
+
+    qint64 percentile(double p) const {
+        if (count_ == 0) return 0;
+        const quint64 rank = quint64(p * (count_ - 1)) + 1;
+        quint64 seen = 0;
+        for (int i = 0; i < Buckets; ++i) {
+            seen += counts_[i];
+            if (seen >= rank) return qMin(upper(i), max_);
+        }
+        return max_;
+    }
+
+    QJsonObject toJson() const {
+        QJsonObject ret;
+        ret["count"] = double(count_);
+        ret["mean_us"] = count_ ? double(sum_) / count_ : 0.0;
+        ret["p50_us"] = double(percentile(0.5));
+        ret["p90_us"] = double(percentile(0.9));
+        ret["p99_us"] = double(percentile(0.99));
+        ret["max_us"] = double(max_);
+        return ret;
+    }
+
+private:
+    static inline int index(quint64 v) {
+        if (v < Sub) return int(v);
+        const int shift = 63 - qCountLeadingZeroBits(v) - SubBits;
+        return qMin(Buckets - 1, ((shift + 1) << SubBits) + int((v >> shift) & (Sub - 1)));
+    }
+
+    static inline qint64 upper(int i) {
+        if (i < Sub) return i;
+        const int shift = (i >> SubBits) - 1;
+        return ((qint64((i & (Sub - 1)) | Sub) + 1) << shift) - 1;
+    }
+
+    quint32 counts_[Buckets] = {};
+    quint64 count_ = 0;
+    qint64 sum_ = 0;
+    qint64 max_ = 0;
+};
+
+struct StatisticsHelper {
+    struct Entry {
+        quint64 errors_{0};
+        quint64 rows_{0};
+        quint64 bytes_{0};
+        Histogram latency_;
+    };
+
+    struct SlowQuery {
+        QString table_;
+        QString op_;
+        QString sql_;
+        qint64 us_;
+    };
+
+    static QMutex mutex;
+    static bool enabled;
+    // statements slower than this (ms) go to the slow query log, -1 disables it
+    static int slowQueryThreshold;
+    static int slowQueryLogSize;
+    static std::function<void(const SlowQuery&)> slowQueryHandler;
+    // called for every failed statement, in release builds too
+    static std::function<void(const QString& sql, const QSqlError&)> errorHandler;
+
+    static QHash<QPair<QString, QString>, Entry> entries;
+    static QQueue<SlowQuery> slowQueries;
+    static Histogram acquireWait;
+    static Histogram hold;
+    static quint64 acquireTimeouts;
+
+    static inline void query(
+            const QString& table, const char* op, qint64 ns, const QSqlQuery& query, int rows) {
+        if (!enabled) return;
+        const qint64 us = ns / 1000;
+        const bool error = query.lastError().type() != QSqlError::NoError;
+        const QString sql = query.lastQuery();
+        {
+            QMutexLocker l(&mutex);
+            auto& entry = entries[qMakePair(table, QString(op))];
+            entry.latency_.record(us);
+            entry.bytes_ += sql.size();
+            if (error) ++entry.errors_;
+            if (rows > 0) entry.rows_ += rows;
+        }
+        if (slowQueryThreshold >= 0 && us >= slowQueryThreshold * 1000ll) {
+            SlowQuery slow{table, op, sql, us};
+            {
+                QMutexLocker l(&mutex);
+                slowQueries.enqueue(slow);
+                while (slowQueries.size() > slowQueryLogSize) slowQueries.dequeue();
+            }
+            if (slowQueryHandler) slowQueryHandler(slow);
+        }
+    }
+
+    static inline void rows(const QString& table, const char* op, int count) {
+        if (!enabled || count <= 0) return;
+        QMutexLocker l(&mutex);
+        entries[qMakePair(table, QString(op))].rows_ += count;
+    }
+
+    static inline void acquire(qint64 ns, bool timeout) {
+        if (!enabled) return;
+        QMutexLocker l(&mutex);
+        acquireWait.record(ns / 1000);
+        if (timeout) ++acquireTimeouts;
+    }
+
+    static inline void release(qint64 ns) {
+        if (!enabled) return;
+        QMutexLocker l(&mutex);
+        hold.record(ns / 1000);
+    }
+
+    static inline void error(const QSqlQuery& query) {
+        if (errorHandler) errorHandler(query.lastQuery(), query.lastError());
+    }
+
+    // work that failed outside a statement, e.g. no connection could be had
+    static inline void failure(const QString& table,
+                               const char* op,
+                               const QString& reason,
+                               QSqlError::ErrorType type = QSqlError::ConnectionError) {
+        if (enabled) {
+            QMutexLocker l(&mutex);
+            ++entries[qMakePair(table, QString(op))].errors_;
+        }
+        if (errorHandler) errorHandler(QString(), QSqlError("WORM", reason, type));
+    }
+
+    static inline QJsonObject snapshot() {
+        QMutexLocker l(&mutex);
+        QJsonArray tables;
+        for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+            QJsonObject entry = it.value().latency_.toJson();
+            entry["table"] = it.key().first;
+            entry["op"] = it.key().second;
+            entry["errors"] = double(it.value().errors_);
+            entry["rows"] = double(it.value().rows_);
+            entry["bytes"] = double(it.value().bytes_);
+            tables.append(entry);
+        }
+        QJsonArray slow;
+        for (const auto& it : slowQueries) {
+            QJsonObject entry;
+            entry["table"] = it.table_;
+            entry["op"] = it.op_;
+            entry["sql"] = it.sql_;
+            entry["us"] = double(it.us_);
+            slow.append(entry);
+        }
+        QJsonObject pool;
+        pool["wait"] = acquireWait.toJson();
+        pool["hold"] = hold.toJson();
+        pool["timeouts"] = double(acquireTimeouts);
+        QJsonObject ret;
+        ret["queries"] = tables;
+        ret["pool"] = pool;
+        ret["slow"] = slow;
+        ret["cache"] = CacheHelper::statistics();
+        return ret;
+    }
+
+    static inline bool dump(const QString& path) {
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+        return file.write(QJsonDocument(snapshot()).toJson()) >= 0;
+    }
+
+    static inline void reset() {
+        QMutexLocker l(&mutex);
+        entries.clear();
+        slowQueries.clear();
+        acquireWait = Histogram();
+        hold = Histogram();
+        acquireTimeouts = 0;
+    }
+};
+
+QMutex StatisticsHelper::mutex;
+bool StatisticsHelper::enabled = true;
+int StatisticsHelper::slowQueryThreshold = 200;
+int StatisticsHelper::slowQueryLogSize = 50;
+std::function<void(const StatisticsHelper::SlowQuery&)> StatisticsHelper::slowQueryHandler =
+        [](const StatisticsHelper::SlowQuery& slow) {
+            qWarning("WORM slow query (%lld us): %s", slow.us_, qPrintable(slow.sql_));
+        };
+std::function<void(const QString&, const QSqlError&)> StatisticsHelper::errorHandler =
+        [](const QString& sql, const QSqlError& error) {
+            qWarning("WORM query failed: %s (%s)", qPrintable(error.text()), qPrintable(sql));
+        };
+QHash<QPair<QString, QString>, StatisticsHelper::Entry> StatisticsHelper::entries;
+QQueue<StatisticsHelper::SlowQuery> StatisticsHelper::slowQueries;
+Histogram StatisticsHelper::acquireWait;
+Histogram StatisticsHelper::hold;
+quint64 StatisticsHelper::acquireTimeouts = 0;
+
 struct DatabaseHelper {
+    // select asks for a reader, everything else for the writer
+    enum class Role { Write, Read };
+
+    struct Pool;
+
     struct DB {
         QSqlDatabase db_;
+        Pool* pool_;
         bool busy_{false};
-        DB(QSqlDatabase db) : db_(db) {}
+        bool broken_{false};
+        QElapsedTimer idle_;
+        QElapsedTimer held_;
+        QHash<QString, QSqlQuery> stmts_;
+        // cached statements currently handed out by prepare()
+        QSet<QString> inUse_;
+        // open transaction plus savepoint levels, and the tables written inside them
+        int depth_{0};
+        QSet<QString> written_;
+        // ORKEY originals saved inside the transaction, applied once it commits; marks_
+        // holds the queue size at each level so rolling a savepoint back drops its part
+        struct Saved {
+            std::weak_ptr<char> alive_;
+            Original* original_;
+            QVariantList values_;
+        };
+        QVector<Saved> saved_;
+        QVector<int> marks_;
+        DB(QSqlDatabase db, Pool* pool) : db_(db), pool_(pool) { idle_.start(); }
+    };
+
+    struct Pool {
+        QVector<DB*> vec;
+        QVector<DB*> idle;
+        QWaitCondition available;
+        // opens a connection under the given name through open(), set up by ConnectionHelper
+        std::function<QSqlDatabase(const QString&)> factory;
+        // the pool grows lazily up to this many connections
+        int maxCount{0};
+        // run on every connection of the pool right after it opens or reopens, e.g. pragmas;
+        // the profile of ConnectionHelper::sqlite() first, then the setup hooks in order
+        std::function<void(QSqlDatabase&)> profile;
+        QVector<std::function<void(QSqlDatabase&)>> setup;
     };
 
     static QMutex mutex;
-    static QVector<DB*> vec;
+    // serves reads as well until the reader pool has a factory
+    static Pool writers;
+    static Pool readers;
+    // milliseconds getDB() waits for a free connection, -1 waits forever
+    static int acquireTimeout;
+    // connections idle longer than this (ms) are pinged before reuse, -1 never pings
+    static int validateInterval;
+    // prepared statements kept per connection before the cache is dropped
+    static int statementCacheSize;
+    // connection owned by the current thread, getDB() hands it out instead of a pooled one
+    static thread_local DB* pinned;
+    // set when the last failure on the current thread would fail the same way again, see
+    // transient(); callers that retry clear it before the attempt
+    static thread_local bool persistentFailure;
 
     class AutoRelease {
     public:
-        AutoRelease(bool* status) { status_ = status; }
-        ~AutoRelease() { *status_ = false; }
+        AutoRelease(DB* db) : db_(db) {}
+        AutoRelease(AutoRelease&& other) : db_(other.db_) { other.db_ = nullptr; }
+        ~AutoRelease() {
+            if (db_) release(db_);
+        }
 
     private:
-        bool* status_ = nullptr;
+        DB* db_ = nullptr;
     };
 
-    static inline auto reset(DB*& db) { return AutoRelease(&db->busy_); }
+    static inline auto reset(DB*& db) { return AutoRelease(db == pinned ? nullptr : db); }
+
+    // pins db to the current thread for the object's lifetime unless a connection already
+    // is, so QueryHelper calls made while db is held reuse it instead of waiting for it
+    class Pin {
+    public:
+        explicit Pin(DB* db) : db_(pinned ? nullptr : db) {
+            if (db_) pinned = db_;
+        }
+        ~Pin() {
+            if (db_) pinned = nullptr;
+        }
+
+        Pin(const Pin&) = delete;
+        Pin& operator=(const Pin&) = delete;
 
-    static inline void checkError(const QSqlQuery& query) {
-        Q_ASSERT(query.lastError().type() == QSqlError::NoError);
+    private:
+        DB* db_ = nullptr;
+    };
+
+    // reports a failed statement in every build, the callers return the failure
+    static inline void checkError(const QSqlQuery& query, DB* db = nullptr) {
+        if (query.lastError().type() == QSqlError::NoError) return;
+        if (db && query.lastError().type() == QSqlError::ConnectionError) db->broken_ = true;
+        const QSqlDriver* driver = query.driver();
+        persistentFailure = !transient(query.lastError(),
+                                       driver && driver->dbmsType() == QSqlDriver::SQLite);
+        StatisticsHelper::error(query);
     }
 
-    static inline DB* getDB() {
+    // whether a failure may pass on a retry: a lost connection, a busy or locked database or
+    // an I/O error. Anything else, e.g. a constraint or a missing column, fails the same way
+    // again
+    static inline bool transient(const QSqlError& error, bool sqlite) {
+        if (error.type() == QSqlError::ConnectionError) return true;
+        bool ok = false;
+        const int code = error.nativeErrorCode().toInt(&ok);
+        if (!ok) return false;
+        if (sqlite) {
+            // primary codes, also of an extended one: BUSY, LOCKED, IOERR, FULL, CANTOPEN
+            const int primary = code & 0xff;
+            return primary == 5 || primary == 6 || primary == 10 || primary == 13 ||
+                   primary == 14;
+        }
+        // MySQL: server gone, connection lost or refused, too many connections, lock wait
+        // timeout, deadlock
+        return code == 2002 || code == 2003 || code == 2006 || code == 2013 || code == 1040 ||
+               code == 1205 || code == 1213;
+    }
+
+    // runs query (or the ad hoc sql), times it and records it under table/op;
+    // rows defaults to the affected row count of a write
+    static inline bool exec(DB* db,
+                            QSqlQuery& query,
+                            const QString& table,
+                            const char* op,
+                            const QString& sql = QString(),
+                            int rows = -1) {
+        QElapsedTimer timer;
+        timer.start();
+        bool ok = sql.isEmpty() ? query.exec() : query.exec(sql);
+        if (rows < 0) rows = query.isSelect() ? 0 : query.numRowsAffected();
+        StatisticsHelper::query(table, op, timer.nsecsElapsed(), query, rows);
+        // a free-form statement that returned rows read, anything else may have written
+        if (qstrcmp(op, "select") != 0 && !query.isSelect()) {
+            CacheHelper::invalidate(table);
+            if (db->depth_ > 0) db->written_ << table;
+        }
+        checkError(query, db);
+        return ok;
+    }
+
+    static inline bool execBatch(
+            DB* db, QSqlQuery& query, const QString& table, const char* op, int rows) {
+        QElapsedTimer timer;
+        timer.start();
+        bool ok = query.execBatch();
+        StatisticsHelper::query(table, op, timer.nsecsElapsed(), query, rows);
+        CacheHelper::invalidate(table);
+        if (db->depth_ > 0) db->written_ << table;
+        checkError(query, db);
+        return ok;
+    }
+
+    // a query handed out by prepare(), its cache entry stays marked in use until it goes
+    // out of scope so a nested identical statement gets a query of its own
+    class Statement : public QSqlQuery {
+    public:
+        explicit Statement(DB* db) : QSqlQuery(db->db_) { setForwardOnly(true); }
+        Statement(const QSqlQuery& query, DB* db, const QString& sql)
+                : QSqlQuery(query), db_(db), sql_(sql) {}
+        Statement(Statement&& other) : QSqlQuery(other), db_(other.db_), sql_(other.sql_) {
+            other.db_ = nullptr;
+        }
+        ~Statement() {
+            if (db_) db_->inUse_.remove(sql_);
+        }
+
+    private:
+        DB* db_ = nullptr;
+        QString sql_;
+    };
+
+    static inline Statement prepare(DB* db, const QString& sql) {
+        const bool busy = db->inUse_.contains(sql);
+        if (!busy) {
+            auto it = db->stmts_.constFind(sql);
+            if (it != db->stmts_.constEnd()) {
+                db->inUse_ << sql;
+                return Statement(*it, db, sql);
+            }
+        }
+        QSqlQuery query(db->db_);
+        query.setForwardOnly(true);
+        if (!query.prepare(sql) || busy) return Statement(query, nullptr, sql);
+        if (db->stmts_.size() >= statementCacheSize) db->stmts_.clear();
+        db->stmts_.insert(sql, query);
+        db->inUse_ << sql;
+        return Statement(query, db, sql);
+    }
+
+    static inline bool sqlite(DB* db) { return db->db_.driverName() == "QSQLITE"; }
+
+    // starts a transaction, or a savepoint when one is already open on db
+    static inline bool begin(DB* db) {
+        bool ok = db->depth_ == 0
+                          ? db->db_.transaction()
+                          : QSqlQuery(QString("savepoint WORM%1;").arg(db->depth_), db->db_)
+                                    .isActive();
+        if (ok) {
+            ++db->depth_;
+            db->marks_.push_back(db->saved_.size());
+        }
+        return ok;
+    }
+
+    static inline bool commit(DB* db) {
+        const int mark = db->marks_.takeLast();
+        if (--db->depth_ > 0) {
+            bool ok = QSqlQuery(QString("release savepoint WORM%1;").arg(db->depth_), db->db_)
+                              .isActive();
+            if (!ok) db->saved_.resize(mark);
+            return ok;
+        }
+        bool ok = db->db_.commit();
+        if (ok) {
+            for (const auto& it : db->saved_)
+                if (!it.alive_.expired()) *it.original_ = it.values_;
+        }
+        db->saved_.clear();
+        finish(db);
+        return ok;
+    }
+
+    static inline bool rollback(DB* db) {
+        db->saved_.resize(db->marks_.takeLast());
+        if (--db->depth_ > 0)
+            return QSqlQuery(QString("rollback to savepoint WORM%1;").arg(db->depth_), db->db_)
+                    .isActive();
+        bool ok = db->db_.rollback();
+        finish(db);
+        return ok;
+    }
+
+    // records that an ORKEY entity now matches the database, deferred to the commit when a
+    // transaction is open since a rollback would leave the old row in place
+    static inline void saved(DB* db, Original* original, const QVariantList& values) {
+        if (db->depth_ == 0)
+            *original = values;
+        else
+            db->saved_.push_back({original->token(), original, values});
+    }
+
+    static inline void bind(QSqlQuery& query, const QVariantList& values, int offset = 0) {
+        for (int i = 0; i < values.size(); ++i) query.bindValue(offset + i, values.at(i));
+    }
+
+    static inline Pool& pool(Role role) {
+        return role == Role::Read && readers.factory ? readers : writers;
+    }
+
+    static inline QString connectionName(const Pool& pool, int index) {
+        return QString(&pool == &readers ? "WORM-read%1" : "WORM%1").arg(index);
+    }
+
+    // opens db and runs the pool's profile and setup hooks on it
+    static inline bool open(Pool& pool, QSqlDatabase& db) {
+        if (!db.open()) return false;
+        if (pool.profile) pool.profile(db);
+        for (const auto& it : pool.setup) it(db);
+        return true;
+    }
+
+    static inline DB* getDB(Role role = Role::Write) { return getDB(acquireTimeout, role); }
+
+    static inline DB* getDB(int timeout, Role role = Role::Write) {
+        // a pinned reader serves reads only, a write next to it takes a pooled writer
+        if (pinned && (role == Role::Read || pinned->pool_ != &readers)) {
+            // a thread's own connection lost to an outage reopens between transactions
+            if (pinned->broken_ && pinned->depth_ == 0) validate(pinned);
+            return pinned;
+        }
+        Pool& pool = DatabaseHelper::pool(role);
+        QElapsedTimer elapsed;
+        elapsed.start();
         QMutexLocker l(&mutex);
         while (true) {
-            for (auto& it : vec) {
-                if (!it->busy_) {
-                    it->busy_ = true;
-                    return it;
+            DB* db = nullptr;
+            int index = -1;
+            if (!pool.idle.isEmpty()) {
+                db = pool.idle.takeLast();
+            } else if (pool.vec.size() < pool.maxCount && pool.factory) {
+                // reserve the slot now, open it outside the lock
+                index = pool.vec.size();
+                db = new DB(QSqlDatabase(), &pool);
+                pool.vec.push_back(db);
+            }
+            if (db) {
+                db->busy_ = true;
+                l.unlock();
+                if (index >= 0) {
+                    db->db_ = pool.factory(connectionName(pool, index));
+                    db->broken_ = !db->db_.isOpen();
+                }
+                StatisticsHelper::acquire(elapsed.nsecsElapsed(), false);
+                db->held_.start();
+                if (validate(db)) return db;
+                release(db);
+                persistentFailure = false;
+                StatisticsHelper::failure(QString(), "acquire", "connection could not be opened");
+                return nullptr;
+            }
+            if (timeout < 0) {
+                pool.available.wait(&mutex);
+            } else {
+                qint64 remaining = timeout - elapsed.elapsed();
+                if (remaining <= 0) {
+                    l.unlock();
+                    StatisticsHelper::acquire(elapsed.nsecsElapsed(), true);
+                    persistentFailure = false;
+                    StatisticsHelper::failure(QString(), "acquire", "no connection within timeout");
+                    return nullptr;
                 }
+                pool.available.wait(&mutex, remaining);
             }
         }
         return nullptr;
     }
+
+    static inline void release(DB* db) {
+        StatisticsHelper::release(db->held_.nsecsElapsed());
+        QMutexLocker l(&mutex);
+        db->busy_ = false;
+        db->idle_.restart();
+        db->pool_->idle.push_back(db);
+        db->pool_->available.wakeOne();
+    }
+
+    // a connection of the pool's kind opened on the current thread and pinned to it for the
+    // object's lifetime, for threads that run WORM work of their own: QtSql allows a
+    // connection only on the thread that opened it, which the shared pool does not guarantee.
+    // Reuses the connection already pinned to the thread, if any
+    class ThreadDB {
+    public:
+        explicit ThreadDB(Role role) {
+            if (pinned) return;
+            Pool& pool = DatabaseHelper::pool(role);
+            static QAtomicInt serial;
+            name_ = QString("WORM-thread%1").arg(serial.fetchAndAddRelaxed(1));
+            db_ = new DB(pool.factory ? pool.factory(name_) : QSqlDatabase(), &pool);
+            db_->busy_ = true;
+            db_->broken_ = !db_->db_.isOpen();
+            pinned = db_;
+        }
+
+        ~ThreadDB() {
+            if (!db_) return;
+            pinned = nullptr;
+            db_->stmts_.clear();
+            db_->db_.close();
+            delete db_;
+            QSqlDatabase::removeDatabase(name_);
+        }
+
+        ThreadDB(const ThreadDB&) = delete;
+        ThreadDB& operator=(const ThreadDB&) = delete;
+
+    private:
+        DB* db_ = nullptr;
+        QString name_;
+    };
+
+    // readers may have cached rows while the transaction was open
+    static inline void finish(DB* db) {
+        for (const auto& it : db->written_) CacheHelper::invalidate(it);
+        db->written_.clear();
+    }
+
+    static inline bool validate(DB* db) {
+        if (!db->broken_ && db->db_.isOpen()) {
+            if (validateInterval < 0 || db->idle_.elapsed() < validateInterval) return true;
+            if (QSqlQuery("select 1", db->db_).isActive()) return true;
+        }
+        db->stmts_.clear();
+        db->db_.close();
+        db->broken_ = !open(*db->pool_, db->db_);
+        return !db->broken_;
+    }
 };
 
 QMutex DatabaseHelper::mutex;
-QVector<DatabaseHelper::DB*> DatabaseHelper::vec;
+DatabaseHelper::Pool DatabaseHelper::writers;
+DatabaseHelper::Pool DatabaseHelper::readers;
+int DatabaseHelper::acquireTimeout = -1;
+int DatabaseHelper::validateInterval = 30000;
+int DatabaseHelper::statementCacheSize = 64;
+thread_local DatabaseHelper::DB* DatabaseHelper::pinned = nullptr;
+thread_local bool DatabaseHelper::persistentFailure = false;
+
+// embedded profile of ConnectionHelper::sqlite
+struct SqliteOptions {
+    // reader connections opened up front and the most the reader pool grows to
+    int readers = 2;
+    int maxReaders = 4;
+    // off | normal | full; with WAL, normal survives an application crash and a power cut
+    // may only lose the last commits
+    QString synchronous = "normal";
+    // bytes of the file read through mmap per connection
+    qint64 mmapSize = 64 << 20;
+    // page cache per connection, in pages or, when negative, in KiB
+    int cacheSize = -4096;
+};
 
 struct ConnectionHelper {
     static inline bool connect(const QString& name,
@@ -55,170 +1102,802 @@ struct ConnectionHelper {
                                const QString& password = "123456",
                                const QString& hostname = "localhost",
                                int port = 3306,
-                               int count = 1) {
+                               int count = 1,
+                               int maxCount = 0) {
+        Q_ASSERT(count > 0);
+        auto& pool = DatabaseHelper::writers;
+        return open(pool, factory(pool, name, type, username, password, hostname, port), count,
+                    maxCount);
+    }
+
+    // separate pool for select, e.g. on a replica; every other statement stays on the
+    // connect() pool
+    static inline bool connectReaders(const QString& name,
+                                      const QString& type = "QMYSQL",
+                                      const QString& username = "root",
+                                      const QString& password = "123456",
+                                      const QString& hostname = "localhost",
+                                      int port = 3306,
+                                      int count = 1,
+                                      int maxCount = 0) {
         Q_ASSERT(count > 0);
-        for (int i = 0; i < count; ++i) {
-            QSqlDatabase db = QSqlDatabase::addDatabase(type, QString("WORM%1").arg(i));
+        auto& pool = DatabaseHelper::readers;
+        return open(pool, factory(pool, name, type, username, password, hostname, port), count,
+                    maxCount);
+    }
+
+    // embedded database file in WAL mode instead of a MySQL server: the pool has one writer
+    // connection, a thread with a connection of its own (ThreadDB) waits for SQLite's write
+    // lock through the busy timeout, readers see the last commit without waiting for it; call
+    // before any query, the pools' setup hooks run after the profile's pragmas; calling it
+    // again replaces the profile and opens no further connections
+    static inline bool sqlite(const QString& path, const SqliteOptions& options = SqliteOptions()) {
+        const QStringList cache = {QString("pragma mmap_size = %1;").arg(options.mmapSize),
+                                   QString("pragma cache_size = %1;").arg(options.cacheSize)};
+        DatabaseHelper::writers.profile = [options, cache](QSqlDatabase& db) {
+            QSqlQuery query(db);
+            query.exec("pragma journal_mode = wal;");
+            query.exec(QString("pragma synchronous = %1;").arg(options.synchronous));
+            for (const auto& it : cache) query.exec(it);
+        };
+        auto& writer = DatabaseHelper::writers;
+        if (!open(writer, factory(writer, path, "QSQLITE", QString(), QString(), QString(), 0), 1,
+                  1))
+            return false;
+        // WAL needs a file, a shared in-memory database keeps everything on the writer
+        if (options.readers <= 0 || path == ":memory:") return true;
+        auto& readers = DatabaseHelper::readers;
+        readers.profile = [cache](QSqlDatabase& db) {
+            QSqlQuery query(db);
+            for (const auto& it : cache) query.exec(it);
+            query.exec("pragma query_only = 1;");
+        };
+        return open(readers, factory(readers, path, "QSQLITE", QString(), QString(), QString(), 0),
+                    options.readers, options.maxReaders);
+    }
+
+private:
+    static inline std::function<QSqlDatabase(const QString&)> factory(
+            DatabaseHelper::Pool& pool,
+            const QString& name,
+            const QString& type,
+            const QString& username,
+            const QString& password,
+            const QString& hostname,
+            int port) {
+        return [=, &pool](const QString& connection) {
+            QSqlDatabase db = QSqlDatabase::addDatabase(type, connection);
             db.setDatabaseName(name);
+            if (type == "QSQLITE") {
+                // pooled connections to ":memory:" must share one database instead of
+                // each opening its own; shared-cache connections that contend for a table
+                // fail with SQLITE_LOCKED at once, the busy timeout only covers file locks
+                if (name == ":memory:") {
+                    db.setDatabaseName("file:WORM?mode=memory&cache=shared");
+                    db.setConnectOptions("QSQLITE_OPEN_URI;QSQLITE_BUSY_TIMEOUT=5000");
+                } else {
+                    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+                }
+            }
             db.setUserName(username);
             db.setPassword(password);
             db.setHostName(hostname);
             db.setPort(port);
-            if (!db.open()) {
+            DatabaseHelper::open(pool, db);
+            return db;
+        };
+    }
+
+    // opens the pool's connections up to count, those of an earlier call are kept
+    static inline bool open(DatabaseHelper::Pool& pool,
+                            std::function<QSqlDatabase(const QString&)> factory,
+                            int count,
+                            int maxCount) {
+        pool.factory = factory;
+        pool.maxCount = qMax(count, maxCount);
+        while (pool.vec.size() < count) {
+            QSqlDatabase db = factory(DatabaseHelper::connectionName(pool, pool.vec.size()));
+            if (!db.isOpen()) {
                 return false;
             }
-            DatabaseHelper::vec.push_back(new DatabaseHelper::DB(db));
+            auto it = new DatabaseHelper::DB(db, &pool);
+            QMutexLocker l(&DatabaseHelper::mutex);
+            pool.vec.push_back(it);
+            pool.idle.push_back(it);
+            pool.available.wakeOne();
         }
         return true;
     }
 };
 
-struct SerializationHelper {
-    template <typename T> static inline void serialize(const T& property, QStringList& value) {
-        QVariant var = property;
-        if (var.type() == QVariant::String) {
-            value << QString("\'%1\'").arg(var.toString());
-        } else {
-            value << var.toString();
-        }
+template <typename R> struct Report {
+    template <typename Fn> static inline void run(QFutureInterface<R>& future, Fn& fn) {
+        future.reportResult(fn());
     }
 };
 
-struct DeserializationHelper {
-    template <typename T> static inline void deserialize(T& property, const QVariant& value) {
-        Q_ASSERT(value.canConvert<T>());
-        property = value.value<T>();
-    }
+template <> struct Report<void> {
+    template <typename Fn> static inline void run(QFutureInterface<void>&, Fn& fn) { fn(); }
 };
 
-class InjectionHelper {
-    static QStringList extractFieldName(std::string input) {
-        QStringList ret;
-        QString tmpStr;
-        for (char ch : std::move(input) + ",") {
-            if (isalnum(ch) || ch == '_')
-                tmpStr += ch;
-            else if (ch == ',') {
-                if (!tmpStr.isEmpty()) ret << tmpStr;
-                tmpStr.clear();
+struct AsyncHelper {
+    // runs its jobs in order on one thread, on a connection the thread opens and keeps; with
+    // sqlite() the first worker's writer waits for the pooled one through the busy timeout
+    class Worker : public QThread {
+    public:
+        Worker(int index) : index_(index) {}
+
+        void post(std::function<void()> job) {
+            QMutexLocker l(&mutex_);
+            jobs_.enqueue(job);
+            ++pending_;
+            cond_.wakeOne();
+        }
+
+        int pending() {
+            QMutexLocker l(&mutex_);
+            return pending_;
+        }
+
+    protected:
+        void run() override {
+            // the first worker writes, the others read, from the reader pool if there is one
+            const DatabaseHelper::ThreadDB db(index_ > 0 ? DatabaseHelper::Role::Read
+                                                         : DatabaseHelper::Role::Write);
+            while (true) {
+                std::function<void()> job;
+                {
+                    QMutexLocker l(&mutex_);
+                    while (jobs_.isEmpty()) cond_.wait(&mutex_);
+                    job = jobs_.dequeue();
+                }
+                // an empty job is the stop request, queued behind everything else
+                if (!job) break;
+                // without a connection the job still runs, its queries report the failure
+                job();
+                QMutexLocker l(&mutex_);
+                --pending_;
+            }
+        }
+
+    private:
+        int index_;
+        int pending_{0};
+        QMutex mutex_;
+        QWaitCondition cond_;
+        QQueue<std::function<void()>> jobs_;
+    };
+
+    static QMutex mutex;
+    static QVector<Worker*> workers;
+    // worker threads started by the first async call, at least two once there is a reader
+    // pool so reads never queue behind writes
+    static int workerCount;
+
+    // every write lands on the first worker so writes run in order on a single connection;
+    // reads go to the least busy of the others, or to the first when it is the only one
+    static inline Worker* route(bool write) {
+        QMutexLocker l(&mutex);
+        if (workers.isEmpty()) {
+            const int count = qMax(DatabaseHelper::readers.factory ? 2 : 1, workerCount);
+            for (int i = 0; i < count; ++i) {
+                workers.push_back(new Worker(i));
+                workers.last()->start();
             }
         }
+        if (write || workers.size() == 1) return workers.first();
+        Worker* ret = workers.at(1);
+        for (int i = 2; i < workers.size(); ++i)
+            if (workers.at(i)->pending() < ret->pending()) ret = workers.at(i);
         return ret;
     }
 
+    template <typename R, typename Fn>
+    static inline QFuture<R> post(const QString& table, bool write, Fn fn) {
+        QFutureInterface<R> future;
+        future.reportStarted();
+        route(write)->post([future, fn, table]() mutable {
+            // a throwing job must not take its worker down, the future finishes without a result
+            try {
+                Report<R>::run(future, fn);
+            } catch (const std::exception& e) {
+                StatisticsHelper::failure(table, "async", e.what(), QSqlError::UnknownError);
+            } catch (...) {
+                StatisticsHelper::failure(table, "async", "unknown exception",
+                                          QSqlError::UnknownError);
+            }
+            future.reportFinished();
+        });
+        return future.future();
+    }
+
+    // drains the queued jobs and joins the worker threads; the lock is not held while
+    // joining, so a draining job may still route() (and start a fresh set of workers)
+    static inline void stop() {
+        QVector<Worker*> stopping;
+        {
+            QMutexLocker l(&mutex);
+            stopping.swap(workers);
+        }
+        for (auto it : stopping) it->post(nullptr);
+        for (auto it : stopping) {
+            it->wait();
+            delete it;
+        }
+    }
+};
+
+QMutex AsyncHelper::mutex;
+QVector<AsyncHelper::Worker*> AsyncHelper::workers;
+int AsyncHelper::workerCount = 2;
+
+// unit of work: pins one connection to the current thread so every QueryHelper call in
+// scope runs on it inside a single transaction; rolled back unless commit() is reached
+class Transaction {
 public:
-    template <typename C, typename Fn> static inline decltype(auto) visit(C& obj, Fn fn) {
-        return obj.__accept(fn);
+    Transaction() {
+        // inside an async worker or another Transaction the pinned connection is reused
+        // and this scope becomes a savepoint; a pinned reader (forEach) stays pinned for
+        // after the transaction, which takes a writer of its own
+        previous_ = DatabaseHelper::pinned;
+        owner_ = !previous_ || previous_->pool_ == &DatabaseHelper::readers;
+        db_ = owner_ ? DatabaseHelper::getDB() : previous_;
+        if (!db_) return;
+        if (owner_) DatabaseHelper::pinned = db_;
+        active_ = DatabaseHelper::begin(db_);
+        if (!active_) unpin();
     }
 
-    template <typename C> static inline const QStringList& fieldNames() {
-        static const QStringList fieldNames = extractFieldName(C::__FieldNames);
-        return fieldNames;
+    ~Transaction() {
+        if (active_) rollback();
     }
 
-    template <typename C> static inline const QString& tableName() {
-        static const QString tableName{C::__TableName};
-        return tableName;
+    Transaction(const Transaction&) = delete;
+    Transaction& operator=(const Transaction&) = delete;
+
+    bool isActive() const { return active_; }
+
+    bool commit() {
+        if (!active_) return false;
+        active_ = false;
+        bool ok = DatabaseHelper::commit(db_);
+        unpin();
+        return ok;
     }
 
-    template <typename C> static inline const QString& fields() {
-        static const QString fields = extractFieldName(C::__FieldNames).join(',');
-        return fields;
+    bool rollback() {
+        if (!active_) return false;
+        active_ = false;
+        bool ok = DatabaseHelper::rollback(db_);
+        unpin();
+        return ok;
     }
+
+    bool savepoint(const QString& name) { return run(QString("savepoint %1;").arg(name)); }
+
+    bool rollbackTo(const QString& name) {
+        return run(QString("rollback to savepoint %1;").arg(name));
+    }
+
+    bool release(const QString& name) { return run(QString("release savepoint %1;").arg(name)); }
+
+private:
+    bool run(const QString& sql) {
+        if (!active_) return false;
+        QSqlQuery query(db_->db_);
+        bool ok = query.exec(sql);
+        DatabaseHelper::checkError(query, db_);
+        return ok;
+    }
+
+    void unpin() {
+        if (!owner_) return;
+        DatabaseHelper::pinned = previous_;
+        DatabaseHelper::release(db_);
+        owner_ = false;
+    }
+
+    DatabaseHelper::DB* db_ = nullptr;
+    DatabaseHelper::DB* previous_ = nullptr;
+    bool owner_ = false;
+    bool active_ = false;
 };
 
 class QueryHelper {
 public:
+    enum class WriteMode { Insert, Replace, Upsert };
+
+    // QFuture based variants running on AsyncHelper's worker threads
+    struct async;
+
+    // rows per multi-row statement, capped so rows * fields stays under maxBindings
+    static int chunkRows;
+    static int chunkBytes;
+    static int maxBindings;
+
     template <typename T>
-    static inline void select(QVector<T>& vec, const QString& condition = "") {
-        select(vec, condition, true);
+    static inline void select(QVector<T>& vec,
+                              const QString& condition = "",
+                              const QVariantList& bindings = {}) {
+        const QString& table = InjectionHelper::tableName<T>();
+        if (!CacheHelper::enabled(table)) {
+            select(vec, condition, bindings, true);
+            return;
+        }
+        const QString key =
+                CacheHelper::key(InjectionHelper::fields<T>() + " where " + condition, bindings);
+        if (CacheHelper::find(table, key, vec)) return;
+        const quint64 generation = CacheHelper::generation(table);
+        if (select(vec, condition, bindings, true) >= 0)
+            CacheHelper::insert(table, key, vec, generation);
     }
 
     template <typename T> static inline void execute(QVector<T>& vec, const QString& cmd = "") {
-        select(vec, cmd, false);
+        select(vec, cmd, {}, false);
+    }
+
+    // reads matching rows one at a time into a reused object, fn(const T&) may
+    // return false to stop early; returns the number of rows visited or -1 on error.
+    // QueryHelper calls inside fn run on the scan's connection, writes on a pooled writer
+    // when the scan has a reader; a driver that cannot run a statement while a result is
+    // open fails them instead
+    template <typename T, typename Fn>
+    static inline int forEach(const QString& condition, Fn fn, const QVariantList& bindings = {}) {
+        return select<T>(condition, bindings, true, [](int) {}, fn);
     }
 
-    template <typename T> static inline void remove(const QString& condition = "") {
-        execute(condition.trimmed().isEmpty()
-                        ? QString("truncate table %1;").arg(InjectionHelper::tableName<T>())
-                        : QString("delete from %1 where %2;")
-                                  .arg(InjectionHelper::tableName<T>())
-                                  .arg(condition));
+    template <typename T>
+    using Columns = decltype(InjectionHelper::visit(std::declval<T&>(), ColumnsOf()));
+
+    // reads matching rows into one contiguous std::vector per field, in ORMAP order,
+    // e.g. std::get<1>(columns) for the second field
+    template <typename T>
+    static inline Columns<T> selectColumns(const QString& condition = "",
+                                           const QVariantList& bindings = {}) {
+        Columns<T> columns;
+        auto db = DatabaseHelper::getDB(DatabaseHelper::Role::Read);
+        if (!db) return columns;
+        auto autoRelease = DatabaseHelper::reset(db);
+        auto query = DatabaseHelper::prepare(
+                db,
+                QString("select %1 from %2 %3;")
+                        .arg(InjectionHelper::fields<T>())
+                        .arg(InjectionHelper::tableName<T>())
+                        .arg(condition.trimmed().isEmpty() ? "" : "where " + condition));
+        DatabaseHelper::bind(query, bindings);
+        DatabaseHelper::exec(db, query, InjectionHelper::tableName<T>(), "select");
+        if (!query.isActive()) return columns;
+        constexpr auto sequence = std::make_index_sequence<InjectionHelper::fieldCount<T>()>();
+        if (query.size() > 0) reserve(columns, query.size(), sequence);
+        int count = 0;
+        for (; query.next(); ++count) append(columns, query, sequence);
+        query.finish();
+        StatisticsHelper::rows(InjectionHelper::tableName<T>(), "select", count);
+        return columns;
     }
 
-    template <typename T> static inline void update(const T& t, const QString& condition = "") {
-        QStringList values;
+    template <typename T>
+    static inline void page(QVector<T>& vec,
+                            int limit,
+                            int offset = 0,
+                            const QString& condition = "",
+                            QVariantList bindings = {}) {
+        bindings << limit << offset;
+        select(vec, (condition.trimmed().isEmpty() ? "1 = 1" : condition) + " limit ? offset ?",
+               bindings, true);
+    }
+
+    // the void-looking writers return false when no connection could be had or the
+    // statement failed, the failure is also counted by StatisticsHelper
+    template <typename T>
+    static inline bool remove(const QString& condition = "", const QVariantList& bindings = {}) {
+        auto db = DatabaseHelper::getDB();
+        if (!db) return false;
+        auto autoRelease = DatabaseHelper::reset(db);
+        if (condition.trimmed().isEmpty()) {
+            // sqlite has no truncate, an unconditional delete takes its truncate path
+            QSqlQuery query(db->db_);
+            DatabaseHelper::exec(db, query, InjectionHelper::tableName<T>(), "remove",
+                                 QString(DatabaseHelper::sqlite(db) ? "delete from %1;"
+                                                                    : "truncate table %1;")
+                                         .arg(InjectionHelper::tableName<T>()));
+            return query.lastError().type() == QSqlError::NoError;
+        }
+        auto query = DatabaseHelper::prepare(
+                db,
+                QString("delete from %1 where %2;")
+                        .arg(InjectionHelper::tableName<T>())
+                        .arg(condition));
+        DatabaseHelper::bind(query, bindings);
+        DatabaseHelper::exec(db, query, InjectionHelper::tableName<T>(), "remove");
+        return query.lastError().type() == QSqlError::NoError;
+    }
+
+    template <typename T>
+    static inline bool update(const T& t,
+                              const QString& condition = "",
+                              const QVariantList& bindings = {}) {
+        QVariantList values;
         InjectionHelper::visit(t, [&values](auto&... args) {
-            int index = 0;
-            std::initializer_list<int>{(SerializationHelper::serialize(args, values),
-                                        values.last().prepend(QString("%1 = ").arg(
-                                                InjectionHelper::fieldNames<T>().at(index++))),
-                                        0)...};
+            std::initializer_list<int>{(SerializationHelper::serialize(args, values), 0)...};
         });
+        // ORKEY entities send only changed fields and, without a condition, match on the key
+        const quint64 mask = InjectionHelper::dirty(t, values);
+        if (mask == 0) return true;
+        Original* original = InjectionHelper::original(t);
+        const auto& keys = InjectionHelper::keyIndexes<T>();
+        const bool byKey = condition.trimmed().isEmpty() && !keys.isEmpty();
         auto db = DatabaseHelper::getDB();
+        if (!db) return false;
         auto autoRelease = DatabaseHelper::reset(db);
-        DatabaseHelper::checkError(db->db_.exec(
+        auto query = DatabaseHelper::prepare(
+                db,
                 QString("update %1 set %2 %3;")
                         .arg(InjectionHelper::tableName<T>())
-                        .arg(values.join(','))
-                        .arg(condition.trimmed().isEmpty() ? "" : "where " + condition)));
+                        .arg(original ? assignments<T>(mask) : InjectionHelper::assignments<T>())
+                        .arg(byKey ? "where " + InjectionHelper::keyCondition<T>()
+                             : condition.trimmed().isEmpty() ? ""
+                                                             : "where " + condition));
+        int index = 0;
+        for (int i = 0; i < values.size(); ++i)
+            if (!original || mask >> i & 1) query.bindValue(index++, values.at(i));
+        if (byKey) {
+            const QVariantList& key = original && !original->isEmpty() ? *original : values;
+            for (int it : keys) query.bindValue(index++, key.at(it));
+        } else {
+            DatabaseHelper::bind(query, bindings, index);
+        }
+        DatabaseHelper::exec(db, query, InjectionHelper::tableName<T>(), "update");
+        if (query.lastError().type() != QSqlError::NoError) return false;
+        if (original) DatabaseHelper::saved(db, original, values);
+        return true;
     }
 
-    template <typename T> static inline void update(const QVector<T>& vec) { insert(vec, false); }
+    // ORKEY entities are updated by key with only their changed fields, grouped into
+    // one batch per set of changed fields; other entities are replaced
+    template <typename T> static inline int update(const QVector<T>& vec) {
+        if (InjectionHelper::keyIndexes<T>().isEmpty()) return bulk(vec, WriteMode::Replace);
+        return updateByKey(vec);
+    }
+
+    template <typename T> static inline int insert(const QVector<T>& vec) {
+        return bulk(vec, WriteMode::Insert);
+    }
 
-    template <typename T> static inline void insert(const QVector<T>& vec) { insert(vec, true); }
+    // writes every element of a container in chunks inside one transaction,
+    // returns the number of rows written or -1 on error (the batch is rolled back)
+    template <typename Range>
+    static inline int bulk(const Range& range, WriteMode mode = WriteMode::Insert) {
+        using T = std::decay_t<decltype(*std::begin(range))>;
+        auto it = std::begin(range);
+        auto end = std::end(range);
+        return write<T>(
+                [&it, &end]() -> const T* { return it == end ? nullptr : &*it++; }, mode);
+    }
 
-    static inline void execute(const QString& cmd = "") {
+    // same as bulk() but pulls rows from next(T&) until it returns false
+    template <typename T, typename Fn>
+    static inline int generate(Fn next, WriteMode mode = WriteMode::Insert) {
+        T t;
+        return write<T>([&t, &next]() -> const T* { return next(t) ? &t : nullptr; }, mode);
+    }
+
+    static inline bool execute(const QString& cmd = "") {
         auto db = DatabaseHelper::getDB();
+        if (!db) return false;
         auto autoRelease = DatabaseHelper::reset(db);
-        DatabaseHelper::checkError(db->db_.exec(cmd));
+        QSqlQuery query(db->db_);
+        DatabaseHelper::exec(db, query, QString(), "execute", cmd);
+        return query.lastError().type() == QSqlError::NoError;
     }
 
 private:
-    template <typename T> static inline void select(QVector<T>& vec, const QString& cmd, bool q) {
+    template <typename Fn, typename T>
+    static inline auto visit(Fn& fn, const T& t)
+            -> std::enable_if_t<std::is_void<decltype(fn(t))>::value, bool> {
+        fn(t);
+        return true;
+    }
+
+    template <typename Fn, typename T>
+    static inline auto visit(Fn& fn, const T& t)
+            -> std::enable_if_t<!std::is_void<decltype(fn(t))>::value, bool> {
+        return fn(t);
+    }
+
+    template <typename T>
+    static inline int select(QVector<T>& vec,
+                             const QString& cmd,
+                             const QVariantList& bindings,
+                             bool q) {
         vec.clear();
-        auto db = DatabaseHelper::getDB();
+        return select<T>(
+                cmd, bindings, q,
+                [&vec](int size) {
+                    if (size > 0) vec.reserve(size);
+                },
+                [&vec](const T& t) { vec.push_back(t); });
+    }
+
+    template <typename T, typename Hint, typename Fn>
+    static inline int select(
+            const QString& cmd, const QVariantList& bindings, bool q, Hint hint, Fn fn) {
+        auto db = DatabaseHelper::getDB(DatabaseHelper::Role::Read);
+        if (!db) return -1;
         auto autoRelease = DatabaseHelper::reset(db);
-        QSqlQuery query(q ? QString("select %1 from %2 %3;")
-                                        .arg(InjectionHelper::fields<T>())
-                                        .arg(InjectionHelper::tableName<T>())
-                                        .arg(cmd.trimmed().isEmpty() ? "" : "where " + cmd)
-                          : cmd,
-                        db->db_);
-        DatabaseHelper::checkError(query);
+        auto query = q ? DatabaseHelper::prepare(
+                                 db,
+                                 QString("select %1 from %2 %3;")
+                                         .arg(InjectionHelper::fields<T>())
+                                         .arg(InjectionHelper::tableName<T>())
+                                         .arg(cmd.trimmed().isEmpty() ? "" : "where " + cmd))
+                       : DatabaseHelper::Statement(db);
+        if (q) {
+            DatabaseHelper::bind(query, bindings);
+            DatabaseHelper::exec(db, query, InjectionHelper::tableName<T>(), "select");
+        } else {
+            DatabaseHelper::exec(db, query, InjectionHelper::tableName<T>(), "select", cmd);
+        }
+        if (!query.isActive()) return -1;
+        hint(query.size());
+        // nested calls in fn must not wait for the connection this scan holds
+        const DatabaseHelper::Pin pin(db);
+        // resolve result columns once per result set, generated selects are positional
+        int columns[InjectionHelper::fieldCount<T>()];
+        const QSqlRecord record = q ? QSqlRecord() : query.record();
+        for (int i = 0; i < InjectionHelper::fieldCount<T>(); ++i)
+            columns[i] = q ? i : record.indexOf(InjectionHelper::fieldNames<T>().at(i));
+        int count = 0;
+        T t;
+        QVariantList* original = InjectionHelper::original(t);
         while (query.next()) {
-            T t;
-            InjectionHelper::visit(t, [q, query](auto&... args) {
+            InjectionHelper::visit(t, [&query, &columns](auto&... args) {
                 int index = 0;
                 std::initializer_list<int>{
-                        (DeserializationHelper::deserialize(
-                                 args,
-                                 q ? query.value(index++)
-                                   : query.value(InjectionHelper::fieldNames<T>().at(index++))),
+                        (DeserializationHelper::deserialize(args, query.value(columns[index++])),
                          0)...};
             });
-            vec.push_back(t);
+            if (original) {
+                original->clear();
+                InjectionHelper::visit(t, [original](auto&... args) {
+                    std::initializer_list<int>{
+                            (SerializationHelper::serialize(args, *original), 0)...};
+                });
+            }
+            ++count;
+            if (!visit(fn, t)) break;
         }
+        query.finish();
+        StatisticsHelper::rows(InjectionHelper::tableName<T>(), "select", count);
+        return count;
+    }
+
+    template <typename Tuple, std::size_t... I>
+    static inline void reserve(Tuple& columns, int size, std::index_sequence<I...>) {
+        std::initializer_list<int>{(std::get<I>(columns).reserve(size), 0)...};
+    }
+
+    template <typename Tuple, std::size_t... I>
+    static inline void append(Tuple& columns, const QSqlQuery& query, std::index_sequence<I...>) {
+        std::initializer_list<int>{(append(std::get<I>(columns), query.value(int(I))), 0)...};
     }
 
-    template <typename T> static inline void insert(const QVector<T>& vec, bool insert) {
-        QStringList values;
-        for (auto it : vec) {
-            QStringList value;
-            InjectionHelper::visit(it, [&value](auto&... args) {
-                std::initializer_list<int>{(SerializationHelper::serialize(args, value), 0)...};
+    template <typename F> static inline void append(std::vector<F>& column, const QVariant& value) {
+        F property;
+        DeserializationHelper::deserialize(property, value);
+        column.push_back(std::move(property));
+    }
+
+    template <typename T> static inline QString assignments(quint64 mask) {
+        if (mask == InjectionHelper::allFields<T>()) return InjectionHelper::assignments<T>();
+        QStringList ret;
+        for (int i = 0; i < InjectionHelper::fieldCount<T>(); ++i)
+            if (mask >> i & 1) ret << QString("%1 = ?").arg(InjectionHelper::fieldNames<T>().at(i));
+        return ret.join(',');
+    }
+
+    template <typename T> static inline int updateByKey(const QVector<T>& vec) {
+        const auto& keys = InjectionHelper::keyIndexes<T>();
+        QHash<quint64, QVector<QVariantList>> groups;
+        for (const auto& it : vec) {
+            QVariantList values;
+            InjectionHelper::visit(it, [&values](auto&... args) {
+                std::initializer_list<int>{(SerializationHelper::serialize(args, values), 0)...};
             });
-            values << QString("(%1)").arg(value.join(','));
+            const quint64 mask = InjectionHelper::dirty(it, values);
+            if (mask == 0) continue;
+            const QVariantList* original = InjectionHelper::original(it);
+            const QVariantList& key = original && !original->isEmpty() ? *original : values;
+            auto& columns = groups[mask];
+            if (columns.isEmpty()) columns.resize(qPopulationCount(mask) + keys.size());
+            int index = 0;
+            for (int i = 0; i < values.size(); ++i)
+                if (mask >> i & 1) columns[index++] << values.at(i);
+            for (int i : keys) columns[index++] << key.at(i);
         }
+        if (groups.isEmpty()) return 0;
+
         auto db = DatabaseHelper::getDB();
+        if (!db) return -1;
         auto autoRelease = DatabaseHelper::reset(db);
-        DatabaseHelper::checkError(db->db_.exec(QString("%1 into %2 (%3) values %4;")
-                                                        .arg(insert ? "insert" : "replace")
-                                                        .arg(InjectionHelper::tableName<T>())
-                                                        .arg(InjectionHelper::fields<T>())
-                                                        .arg(values.join(','))));
+        const bool transaction = DatabaseHelper::begin(db);
+        bool ok = true;
+        int written = 0;
+        for (auto it = groups.constBegin(); ok && it != groups.constEnd(); ++it) {
+            auto query = DatabaseHelper::prepare(db,
+                                                 QString("update %1 set %2 where %3;")
+                                                         .arg(InjectionHelper::tableName<T>())
+                                                         .arg(assignments<T>(it.key()))
+                                                         .arg(InjectionHelper::keyCondition<T>()));
+            for (int i = 0; i < it.value().size(); ++i) query.bindValue(i, it.value().at(i));
+            const int rows = it.value().first().size();
+            ok = DatabaseHelper::execBatch(db, query, InjectionHelper::tableName<T>(), "update",
+                                           rows);
+            written += rows;
+        }
+        if (transaction) {
+            if (ok)
+                ok = DatabaseHelper::commit(db);
+            else
+                DatabaseHelper::rollback(db);
+        }
+        if (!ok) return -1;
+        for (const auto& it : vec) {
+            if (Original* original = InjectionHelper::original(it)) {
+                QVariantList values;
+                InjectionHelper::visit(it, [&values](auto&... args) {
+                    std::initializer_list<int>{
+                            (SerializationHelper::serialize(args, values), 0)...};
+                });
+                DatabaseHelper::saved(db, original, values);
+            }
+        }
+        return written;
+    }
+
+    template <typename T> static inline QString statement(WriteMode mode, int rows, bool sqlite) {
+        const QString& upserts = InjectionHelper::upserts<T>(sqlite);
+        QString verb = mode == WriteMode::Replace ? "replace" : "insert";
+        QString conflict;
+        if (mode == WriteMode::Upsert) {
+            if (upserts.isEmpty()) {
+                // every field is part of the key, a duplicate has nothing left to update
+                verb = sqlite ? "insert or ignore" : "insert ignore";
+            } else if (!sqlite) {
+                conflict = " on duplicate key update " + upserts;
+            } else if (!InjectionHelper::keyIndexes<T>().isEmpty()) {
+                // sqlite 3.24 upsert, needs the conflict target
+                conflict = QString(" on conflict(%1) do update set %2")
+                                   .arg(InjectionHelper::keys<T>())
+                                   .arg(upserts);
+            } else {
+                // without a declared key sqlite can only express an upsert as replace
+                verb = "replace";
+            }
+        }
+        QStringList tuples;
+        for (int i = 0; i < rows; ++i) tuples << "(" + InjectionHelper::placeholders<T>() + ")";
+        return QString("%1 into %2 (%3) values %4%5;")
+                .arg(verb)
+                .arg(InjectionHelper::tableName<T>())
+                .arg(InjectionHelper::fields<T>())
+                .arg(tuples.join(','))
+                .arg(conflict);
+    }
+
+    template <typename T, typename Fn> static inline int write(Fn next, WriteMode mode) {
+        const T* t = next();
+        if (!t) return 0;
+        auto db = DatabaseHelper::getDB();
+        if (!db) return -1;
+        auto autoRelease = DatabaseHelper::reset(db);
+
+        const int fieldCount = InjectionHelper::fieldNames<T>().size();
+        const int rows = qMax(1, qMin(chunkRows, maxBindings / fieldCount));
+        QVariantList values;
+        values.reserve(rows * fieldCount);
+        int pending = 0, bytes = 0, written = 0;
+        const char* op = mode == WriteMode::Insert    ? "insert"
+                         : mode == WriteMode::Replace ? "replace"
+                                                      : "upsert";
+
+        // full chunks go through the cached multi-row statement, a short tail or a
+        // byte-limited chunk through the single-row one as a batch
+        auto flush = [&]() {
+            if (pending == 0) return true;
+            auto query =
+                    DatabaseHelper::prepare(db, statement<T>(mode, pending == rows ? rows : 1,
+                                                             DatabaseHelper::sqlite(db)));
+            if (pending == rows) {
+                DatabaseHelper::bind(query, values);
+                DatabaseHelper::exec(
+                        db, query, InjectionHelper::tableName<T>(), op, QString(), rows);
+            } else {
+                for (int i = 0; i < fieldCount; ++i) {
+                    QVariantList column;
+                    for (int j = 0; j < pending; ++j) column << values.at(j * fieldCount + i);
+                    query.bindValue(i, column);
+                }
+                DatabaseHelper::execBatch(db, query, InjectionHelper::tableName<T>(), op, pending);
+            }
+            if (query.lastError().type() != QSqlError::NoError) return false;
+            written += pending;
+            pending = bytes = 0;
+            values.clear();
+            return true;
+        };
+
+        const bool transaction = DatabaseHelper::begin(db);
+        bool ok = true;
+        for (; t && ok; t = next()) {
+            InjectionHelper::visit(*t, [&values](auto&... args) {
+                std::initializer_list<int>{(SerializationHelper::serialize(args, values), 0)...};
+            });
+            for (int i = values.size() - fieldCount; i < values.size(); ++i)
+                bytes += SerializationHelper::estimate(values.at(i));
+            if (++pending == rows || bytes >= chunkBytes) ok = flush();
+        }
+        ok = ok && flush();
+        if (transaction) {
+            if (ok)
+                ok = DatabaseHelper::commit(db);
+            else
+                DatabaseHelper::rollback(db);
+        }
+        return ok ? written : -1;
+    }
+};
+
+struct QueryHelper::async {
+    template <typename T>
+    static inline QFuture<QVector<T>> select(const QString& condition = "",
+                                             const QVariantList& bindings = {}) {
+        return AsyncHelper::post<QVector<T>>(InjectionHelper::tableName<T>(), false,
+                                             [condition, bindings]() {
+                                                 QVector<T> vec;
+                                                 QueryHelper::select(vec, condition, bindings);
+                                                 return vec;
+                                             });
+    }
+
+    template <typename T> static inline QFuture<int> insert(const QVector<T>& vec) {
+        return AsyncHelper::post<int>(InjectionHelper::tableName<T>(), true,
+                                      [vec]() { return QueryHelper::insert(vec); });
+    }
+
+    template <typename T> static inline QFuture<int> update(const QVector<T>& vec) {
+        return AsyncHelper::post<int>(InjectionHelper::tableName<T>(), true,
+                                      [vec]() { return QueryHelper::update(vec); });
+    }
+
+    template <typename T>
+    static inline QFuture<bool> update(const T& t,
+                                       const QString& condition = "",
+                                       const QVariantList& bindings = {}) {
+        return AsyncHelper::post<bool>(InjectionHelper::tableName<T>(), true,
+                                       [t, condition, bindings]() {
+                                           return QueryHelper::update(t, condition, bindings);
+                                       });
+    }
+
+    template <typename T>
+    static inline QFuture<bool> remove(const QString& condition = "",
+                                       const QVariantList& bindings = {}) {
+        return AsyncHelper::post<bool>(InjectionHelper::tableName<T>(), true,
+                                       [condition, bindings]() {
+                                           return QueryHelper::remove<T>(condition, bindings);
+                                       });
+    }
+
+    static inline QFuture<bool> execute(const QString& cmd = "") {
+        return AsyncHelper::post<bool>(QString(), true,
+                                       [cmd]() { return QueryHelper::execute(cmd); });
     }
 };
+
+int QueryHelper::chunkRows = 500;
+int QueryHelper::chunkBytes = 1 << 20;
+int QueryHelper::maxBindings = 999;
 }  // namespace WORM
 
 #define ORMAP(_TABLE_NAME_, ...)                                                                   \
@@ -226,5 +1905,22 @@ private:
     friend class WORM::InjectionHelper;                                                            \
     template <typename FN> inline decltype(auto) __accept(FN fn) { return fn(__VA_ARGS__); }       \
     template <typename FN> inline decltype(auto) __accept(FN fn) const { return fn(__VA_ARGS__); } \
+    constexpr static const char* __TableName = _TABLE_NAME_;                                       \
     constexpr static const char* __FieldNames = #__VA_ARGS__;                                      \
-    constexpr static const char* __TableName = _TABLE_NAME_;
\ No newline at end of file
+    constexpr static int __FieldCount = WORM::InjectionHelper::countFields(#__VA_ARGS__);          \
+    constexpr static WORM::FieldArray<__FieldCount> __Fields() {                                   \
+        return WORM::InjectionHelper::parseFields<__FieldCount>(#__VA_ARGS__);                     \
+    }
+
+// declares the primary key of an ORMAP entity; the entity then remembers the values it was
+// loaded with so QueryHelper::update writes only changed fields, matched on the key
+#define ORKEY(...)                                                                                 \
+private:                                                                                           \
+    friend class WORM::InjectionHelper;                                                            \
+    static_assert(__FieldCount <= 64, "ORKEY change tracking is limited to 64 fields");            \
+    constexpr static const char* __KeyNames = #__VA_ARGS__;                                        \
+    static_assert(WORM::InjectionHelper::containsAll(__FieldNames, #__VA_ARGS__),                  \
+                  "ORKEY names a field that is not in ORMAP");                                     \
+    mutable WORM::Original __original;
+
+#endif  // WORM_HPP